@@ -1,25 +1,68 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <bit>
 #include <cassert>
+#include <cctype>
+#include <chrono>
 #include <cmath>
 #include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <filesystem>
+#include <fstream>
 #include <functional>
+#include <future>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <memory_resource>
 #include <mutex>
+#include <new>
+#include <numbers>
 #include <numeric>
 #include <optional>
-#include <queue>
+#include <random>
 #include <SFML/Audio.hpp>
 #include <SFML/Graphics.hpp>
 #include <SFML/Window.hpp>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
+// MSVC never defines __SSE2__; SSE2 is implied on x64 and opt-in with /arch:SSE2 on x86
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPACESHOOTER_SSE2 1
+#endif
+
+#if defined(__AVX2__) || defined(SPACESHOOTER_SSE2)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 namespace Category {
     enum Type {
@@ -31,419 +74,4086 @@ namespace Category {
     };
 }
 
-template<typename T>
-concept LoadableFromFile = requires(T t, const std::filesystem::path & path) {
-    { t.loadFromFile(path) } -> std::convertible_to<bool>;
-};
+// Asset manifest. Resource ids index the holders' slots directly; paths are
+// only looked at when something is actually read from disk.
+namespace Textures {
+    enum ID {
+        Space,
+        Menu,
+        Eagle,
+        Raptor,
+        Count
+    };
+}
 
-template <LoadableFromFile T>
-class ResourceManager {
-public:
-    void load(const std::filesystem::path& path) {
-        std::unique_ptr<T> resource = std::make_unique<T>();
-        if (!resource->loadFromFile(path)) {
-            throw std::runtime_error("Can't load resource from file: " + path.string());
-        }
-        resources_[path] = std::move(resource);
+namespace Fonts {
+    enum ID {
+        Main,
+        Count
+    };
+}
+
+namespace Levels {
+    enum ID {
+        First,
+        Count
+    };
+}
+
+namespace SoundEffects {
+    enum ID {
+        Fire,
+        Explosion,
+        Count
+    };
+}
+
+namespace Music {
+    enum ID {
+        MenuTheme,
+        MissionTheme,
+        Count
+    };
+}
+
+namespace Assets {
+    inline constexpr std::array<std::string_view, Textures::Count> texturePaths = { {
+        "Textures/Space.png",
+        "Textures/Menu.png",
+        "Textures/Eagle.png",
+        "Textures/Raptor.png",
+    } };
+
+    inline constexpr std::array<std::string_view, Fonts::Count> fontPaths = { {
+        "Fonts/RobotoMono-Italic-VariableFont_wght.ttf",
+    } };
+
+    inline constexpr std::array<std::string_view, Levels::Count> levelPaths = { {
+        "Levels/Level1.txt",
+    } };
+
+    // Audio is optional: whatever is missing just stays silent
+    inline constexpr std::array<std::string_view, SoundEffects::Count> soundPaths = { {
+        "Sounds/Fire.wav",
+        "Sounds/Explosion.wav",
+    } };
+
+    inline constexpr std::array<std::string_view, Music::Count> musicPaths = { {
+        "Music/MenuTheme.ogg",
+        "Music/MissionTheme.ogg",
+    } };
+
+    constexpr std::string_view getPath(Textures::ID id) {
+        return texturePaths[id];
     }
 
-    T& get(const std::filesystem::path& path) const {
-        auto it = resources_.find(path);
-        assert(it != resources_.end() && "Resource not found.");
-        return *(it->second);
+    constexpr std::string_view getPath(Fonts::ID id) {
+        return fontPaths[id];
     }
 
-private:
-    mutable std::unordered_map<std::filesystem::path, std::unique_ptr<T>> resources_;
-};
+    constexpr std::string_view getPath(Levels::ID id) {
+        return levelPaths[id];
+    }
 
-class SceneNode;
+    constexpr std::string_view getPath(SoundEffects::ID id) {
+        return soundPaths[id];
+    }
 
-struct Command {
-    std::function<void(SceneNode&, sf::Time)> action_;
-    unsigned int category_ = Category::None;
-};
+    constexpr std::string_view getPath(Music::ID id) {
+        return musicPaths[id];
+    }
 
-class SceneNode : public sf::Transformable, public sf::Drawable {
-public:
-    using Ptr = std::unique_ptr<SceneNode>;
+    // Debug builds only: catches required manifest entries whose file was moved or renamed
+    inline void checkManifest() {
+#ifndef NDEBUG
+        bool complete = true;
+        for (const auto paths : { std::span<const std::string_view>(texturePaths), std::span<const std::string_view>(fontPaths),
+            std::span<const std::string_view>(levelPaths) }) {
+            for (const std::string_view path : paths) {
+                if (!std::filesystem::exists(path)) {
+                    std::cerr << "Asset manifest entry missing on disk: " << path << "\n";
+                    complete = false;
+                }
+            }
+        }
+        assert(complete && "Asset manifest is out of date");
+#endif
+    }
+}
 
-    SceneNode() : parent_(nullptr) {}
+// Counts every global allocation, for the whole process and per frame, when
+// built with SPACESHOOTER_TRACK_ALLOCS; otherwise operator new is left alone and
+// every count stays zero. Frame counts are charged to the innermost AllocationScope open on the allocating
+// thread, so a tag excludes whatever its nested scopes charged elsewhere; other
+// threads count as Untagged. Budgets cap allocations per frame per tag. A frame
+// ends with beginFrame(), called from the thread that drives frames.
+struct AllocationCounter {
+    enum Tag {
+        Untagged,
+        WorldUpdate,
+        Commands,
+        SceneNodes,
+        StateTransitions,
+        TagCount
+    };
 
-    void addChild(Ptr child) {
-        child->parent_ = this;
-        children_.emplace_back(std::move(child));
-    }
+    struct Usage {
+        std::uint64_t allocations_;
+        std::uint64_t bytes_;
+    };
 
-    Ptr detachChild(const SceneNode& node) {
-        auto it = std::ranges::find_if(children_,
-            [&](const Ptr& child) {
-                return child.get() == &node;
-            });
+    static constexpr std::uint64_t unlimited = std::numeric_limits<std::uint64_t>::max();
 
-        assert(it != children_.end() && "Child not found");
+#if defined(SPACESHOOTER_TRACK_ALLOCS)
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
 
-        Ptr result = std::move(*it);
-        result->parent_ = nullptr;
-        children_.erase(it);
-        return result;
-    }
+    static inline std::atomic<std::uint64_t> allocations_{ 0 };
+    static inline std::atomic<std::uint64_t> bytes_{ 0 };
 
-    void update(const sf::Time& dt) {
-        updateCurrent(dt);
-        updateChildren(dt);
+    static void count(std::size_t size) {
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(size, std::memory_order_relaxed);
+        FrameCounters& frame = frame_[currentTag_];
+        frame.allocations_.fetch_add(1, std::memory_order_relaxed);
+        frame.bytes_.fetch_add(size, std::memory_order_relaxed);
     }
 
-    void onCommand(const Command& command, const sf::Time& dt) {
-        if (command.category_ & getCategory()) {
-            command.action_(*this, dt);
+    // Closes the running frame: it becomes getLastFrame(), and tags over budget are tallied
+    static void beginFrame() {
+        for (std::size_t tag = 0; tag < TagCount; ++tag) {
+            last_[tag] = { frame_[tag].allocations_.exchange(0, std::memory_order_relaxed),
+                frame_[tag].bytes_.exchange(0, std::memory_order_relaxed) };
+            if (last_[tag].allocations_ > budgets_[tag]) {
+                ++overBudgetFrames_[tag];
+            }
         }
+    }
 
-        for (auto& child : children_) {
-            child->onCommand(command, dt);
+    static Usage getLastFrame(Tag tag) {
+        return last_[tag];
+    }
+
+    static Usage getLastFrameTotal() {
+        Usage total{};
+        for (const Usage& usage : last_) {
+            total.allocations_ += usage.allocations_;
+            total.bytes_ += usage.bytes_;
         }
+        return total;
     }
 
-    virtual unsigned int getCategory() const {
-        return Category::Scene;
+    static std::uint64_t getBudget(Tag tag) {
+        return budgets_[tag];
     }
 
-private:
-    void updateChildren(const sf::Time& dt) {
-        for (auto& child : children_) {
-            child->update(dt);
-        }
+    static void setBudget(Tag tag, std::uint64_t allocationsPerFrame) {
+        budgets_[tag] = allocationsPerFrame;
     }
 
-    virtual void updateCurrent(const sf::Time&) {}
+    static std::uint64_t getOverBudgetFrames(Tag tag) {
+        return overBudgetFrames_[tag];
+    }
 
-    virtual void drawCurrent(sf::RenderTarget&, sf::RenderStates) const {}
+    static void resetOverBudgetFrames() {
+        overBudgetFrames_.fill(0);
+    }
 
-    void draw(sf::RenderTarget& target, sf::RenderStates states) const final override {
-        states.transform *= getTransform();
-        drawCurrent(target, states);
-        for (const auto& child : children_) {
-            child->draw(target, states);
-        }
+    static const char* getName(Tag tag) {
+        static constexpr std::array<const char*, TagCount> names = {
+            "untagged", "World::update", "CommandQueue", "SceneNode", "StateStack",
+        };
+        return names[tag];
     }
 
-    SceneNode* parent_;
-    std::vector<Ptr> children_;
+private:
+    friend class AllocationScope;
+
+    struct FrameCounters {
+        std::atomic<std::uint64_t> allocations_;
+        std::atomic<std::uint64_t> bytes_;
+    };
+
+    static inline thread_local Tag currentTag_ = Untagged;
+    static inline std::array<FrameCounters, TagCount> frame_{};
+    static inline std::array<Usage, TagCount> last_{};
+    static inline std::array<std::uint64_t, TagCount> overBudgetFrames_{};
+    // Steady-state hot paths; transitions and everything untagged may allocate freely
+    static inline std::array<std::uint64_t, TagCount> budgets_ = {
+        unlimited, // Untagged
+        8,         // WorldUpdate
+        1,         // Commands
+        4,         // SceneNodes
+        unlimited, // StateTransitions
+    };
 };
 
-class SpriteNode : public SceneNode {
+// Charges this thread's allocations to tag until it goes out of scope
+class AllocationScope {
 public:
-    explicit SpriteNode(const sf::Texture& texture)
-        : sprite_(texture) {
+    explicit AllocationScope(AllocationCounter::Tag tag)
+        : previous_(std::exchange(AllocationCounter::currentTag_, tag)) {
     }
 
-    SpriteNode(const sf::Texture& texture, const sf::IntRect& rect)
-        : sprite_(texture, rect) {
+    ~AllocationScope() {
+        AllocationCounter::currentTag_ = previous_;
     }
 
-private:
-    void drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const override {
-        target.draw(sprite_, states);
-    }
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
 
-    sf::Sprite sprite_;
+private:
+    AllocationCounter::Tag previous_;
 };
 
-using TextureHolder = ResourceManager<sf::Texture>;
+#if defined(SPACESHOOTER_TRACK_ALLOCS)
+// Every replaceable form is replaced, so aligned and nothrow allocations are
+// counted too and never reach a deallocation function that did not allocate them
+namespace TrackedHeap {
+    inline void* allocate(std::size_t size) noexcept {
+        AllocationCounter::count(size);
+        return std::malloc(size != 0 ? size : 1);
+    }
 
-class Entity : public SceneNode {
-public:
-    void setVelocity(const sf::Vector2f& velocity) {
-        velocity_ = velocity;
+    inline void* allocate(std::size_t size, std::align_val_t alignment) noexcept {
+        AllocationCounter::count(size);
+        const auto align = static_cast<std::size_t>(alignment);
+#if defined(_WIN32)
+        return _aligned_malloc(size != 0 ? size : 1, align);
+#else
+        // aligned_alloc wants a whole number of alignments
+        return std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+#endif
     }
 
-    void setVelocity(float dx, float dy) {
-        velocity_ = sf::Vector2f(dx, dy);
+    inline void release(void* memory) noexcept {
+        std::free(memory);
     }
 
-    void accelerate(float x, float y) {
-        sf::Vector2f newVelocity(x, y);
-        setVelocity(getVelocity() + newVelocity);
+    inline void release(void* memory, std::align_val_t) noexcept {
+#if defined(_WIN32)
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
     }
+}
 
-    const sf::Vector2f& getVelocity() const {
-        return velocity_;
+void* operator new(std::size_t size) {
+    if (void* memory = TrackedHeap::allocate(size)) {
+        return memory;
     }
+    throw std::bad_alloc();
+}
 
-protected:
-    void updateCurrent(const sf::Time& dt) override {
-        move(velocity_ * dt.asSeconds());
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return TrackedHeap::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return TrackedHeap::allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* memory = TrackedHeap::allocate(size, alignment)) {
+        return memory;
     }
+    throw std::bad_alloc();
+}
 
-private:
-    sf::Vector2f velocity_;
-};
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return ::operator new(size, alignment);
+}
 
-class Aircraft : public Entity {
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return TrackedHeap::allocate(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return TrackedHeap::allocate(size, alignment);
+}
+
+void operator delete(void* memory) noexcept {
+    TrackedHeap::release(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    TrackedHeap::release(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    TrackedHeap::release(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    TrackedHeap::release(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    TrackedHeap::release(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    TrackedHeap::release(memory);
+}
+
+void operator delete(void* memory, std::align_val_t alignment) noexcept {
+    TrackedHeap::release(memory, alignment);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept {
+    TrackedHeap::release(memory, alignment);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept {
+    TrackedHeap::release(memory, alignment);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t alignment) noexcept {
+    TrackedHeap::release(memory, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    TrackedHeap::release(memory, alignment);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    TrackedHeap::release(memory, alignment);
+}
+#endif
+
+// Process-wide frame profiler. ProfileScope records named zones into the
+// current frame; the previous frame's zones and a ring of recent frame times
+// feed the stats overlay. While capturing, every zone is also kept as a
+// Chrome trace event (chrome://tracing, Perfetto). Zones may be recorded from
+// any thread; a frame is whatever lies between two beginFrame() calls on the
+// thread that drives them.
+class Profiler {
 public:
-    enum Type {
-        Eagle,
-        Raptor
+    using Clock = std::chrono::steady_clock;
+
+    enum Counter {
+        DrawCalls,
+        Nodes,
+        Particles,
+        CommandQueueDepth,
+        CounterCount
+    };
+
+    struct Zone {
+        const char* name_ = nullptr;
+        std::int64_t micros_ = 0;
+        unsigned int calls_ = 0;
+    };
+
+    struct FrameStats {
+        float fps_ = 0.f;
+        float p50Ms_ = 0.f;
+        float p95Ms_ = 0.f;
+        float p99Ms_ = 0.f;
     };
 
-    Aircraft(Type type, const std::filesystem::path& path, const TextureHolder& resources)
-        : sprite_(resources.get(path)), type_(type) {
+    static constexpr std::size_t maxZones_ = 16;
+    static constexpr std::size_t frameHistory_ = 240;
+    static constexpr std::size_t maxTraceEvents_ = 1 << 20;
+
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
     }
 
-    unsigned int getCategory() const override {
-        // Only the main Eagle responds to player commands
-        if (type_ == Eagle) {
-            return Category::PlayerAircraft;
+    void beginFrame() {
+        AllocationCounter::beginFrame();
+        const Clock::time_point now = Clock::now();
+        std::scoped_lock lock(mutex_);
+        if (frameStart_ != Clock::time_point{}) {
+            frameTimes_[frameCursor_] = toMicros(now - frameStart_);
+            frameCursor_ = (frameCursor_ + 1) % frameHistory_;
+            frameCount_ = std::min(frameCount_ + 1, frameHistory_);
         }
-        return Category::AlliedAircraft; // Escort aircraft don't respond to player input
+        frameStart_ = now;
+        lastZones_ = zones_;
+        lastZoneCount_ = std::exchange(zoneCount_, 0);
     }
 
-    Type getAircraftType() const {
-        return type_;
-    }
+    void record(const char* name, Clock::time_point start, Clock::time_point end) {
+        const std::int64_t duration = toMicros(end - start);
+        std::scoped_lock lock(mutex_);
 
-private:
-    void drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const override {
-        target.draw(sprite_, states);
-    }
+        auto zone = std::ranges::find(zones_.begin(), zones_.begin() + zoneCount_, name, &Zone::name_);
+        if (zone == zones_.begin() + zoneCount_) {
+            if (zoneCount_ == maxZones_) {
+                return;
+            }
+            *zone = { name, 0, 0 };
+            ++zoneCount_;
+        }
+        zone->micros_ += duration;
+        ++zone->calls_;
 
-    sf::Sprite sprite_;
-    Type type_;
-};
+        if (capturing_ && trace_.size() < maxTraceEvents_) {
+            trace_.push_back({ name, toMicros(start - epoch_), duration, threadIndex() });
+        }
+    }
 
-class CommandQueue {
-public:
-    void emplace(Command command) {
-        cmd_.emplace(std::move(command));
+    void setCounter(Counter counter, std::size_t value) {
+        counters_[counter].store(value, std::memory_order_relaxed);
     }
 
-    bool isEmpty() const {
-        return cmd_.empty();
+    std::size_t getCounter(Counter counter) const {
+        return counters_[counter].load(std::memory_order_relaxed);
     }
 
-    Command pop() {
-        Command result = std::move(cmd_.front());
-        cmd_.pop();
-        return result;
+    std::span<const Zone> getLastFrameZones() const {
+        return { lastZones_.data(), lastZoneCount_ };
     }
 
-private:
-    std::queue<Command> cmd_;
-};
+    FrameStats getFrameStats() const {
+        FrameStats stats;
+        if (frameCount_ == 0) {
+            return stats;
+        }
 
-class Player {
-public:
-    Player() {
-        constexpr float playerSpeed = 200.f;
+        std::array<std::int64_t, frameHistory_> sorted;
+        std::copy_n(frameTimes_.begin(), frameCount_, sorted.begin());
+        const auto end = sorted.begin() + static_cast<std::ptrdiff_t>(frameCount_);
+        std::sort(sorted.begin(), end);
 
-        keys_[sf::Keyboard::Key::Left] = "MoveLeft";
-        keys_[sf::Keyboard::Key::Right] = "MoveRight";
-        keys_[sf::Keyboard::Key::Up] = "MoveUp";
-        keys_[sf::Keyboard::Key::Down] = "MoveDown";
+        const auto percentile = [&](float p) {
+            const std::size_t i = std::min(frameCount_ - 1, static_cast<std::size_t>(p * static_cast<float>(frameCount_)));
+            return static_cast<float>(sorted[i]) / 1000.f;
+        };
+        const std::int64_t total = std::accumulate(sorted.begin(), end, std::int64_t{ 0 });
 
-        commands_["MoveUp"].action_ = [playerSpeed](SceneNode& node, sf::Time dt) {
-            node.move({ 0.f, -playerSpeed * dt.asSeconds() });
-            };
+        stats.fps_ = total > 0 ? 1000000.f * static_cast<float>(frameCount_) / static_cast<float>(total) : 0.f;
+        stats.p50Ms_ = percentile(0.50f);
+        stats.p95Ms_ = percentile(0.95f);
+        stats.p99Ms_ = percentile(0.99f);
+        return stats;
+    }
 
-        commands_["MoveDown"].action_ = [playerSpeed](SceneNode& node, sf::Time dt) {
-            node.move({ 0.f, playerSpeed * dt.asSeconds() });
-            };
+    void startCapture() {
+        std::scoped_lock lock(mutex_);
+        trace_.clear();
+        trace_.reserve(maxTraceEvents_);
+        capturing_ = true;
+    }
 
-        commands_["MoveRight"].action_ = [playerSpeed](SceneNode& node, sf::Time dt) {
-            node.move({ playerSpeed * dt.asSeconds(), 0.f });
-            };
+    bool isCapturing() const {
+        std::scoped_lock lock(mutex_);
+        return capturing_;
+    }
 
-        commands_["MoveLeft"].action_ = [playerSpeed](SceneNode& node, sf::Time dt) {
-            node.move({ -playerSpeed * dt.asSeconds(), 0.f });
-            };
+    // Writes everything captured since startCapture() as Chrome trace JSON
+    bool stopCapture(const std::filesystem::path& path) {
+        std::scoped_lock lock(mutex_);
+        capturing_ = false;
+        std::ofstream file(path);
+        if (!file) {
+            return false;
+        }
 
-        for (auto& it : commands_) {
-            it.second.category_ = Category::PlayerAircraft;
+        file << "{\"traceEvents\":[\n";
+        for (std::size_t i = 0; i < trace_.size(); ++i) {
+            const TraceEvent& event = trace_[i];
+            file << (i > 0 ? ",\n" : "")
+                << "{\"name\":\"" << event.name_ << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread_ << ","
+                << "\"ts\":" << event.start_ << ",\"dur\":" << event.duration_ << "}";
         }
+        file << "\n]}\n";
+        trace_.clear();
+        return static_cast<bool>(file);
     }
 
-    void addKeys(const std::string& id, const sf::Keyboard::Key key) {
-        keys_[key] = id;
+private:
+    struct TraceEvent {
+        const char* name_;
+        std::int64_t start_;
+        std::int64_t duration_;
+        unsigned int thread_;
+    };
+
+    Profiler() : epoch_(Clock::now()) {}
+
+    // Small stable id per thread, so traces show one row per thread
+    static unsigned int threadIndex() {
+        static std::atomic<unsigned int> next{ 0 };
+        thread_local const unsigned int index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
     }
 
-    void assignCommand(const std::string& id, const Command& c) {
-        commands_[id] = c;
+    static std::int64_t toMicros(Clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
     }
 
-    sf::Keyboard::Key getAssignKey(const std::string& action) {
-        for (const auto& [key, id] : keys_) {
-            if (id == action) return key;
-        }
-        return sf::Keyboard::Key::Unknown;
+    Clock::time_point epoch_;
+    Clock::time_point frameStart_;
+    std::array<std::int64_t, frameHistory_> frameTimes_{};
+    std::size_t frameCursor_ = 0;
+    std::size_t frameCount_ = 0;
+    std::array<Zone, maxZones_> zones_{};
+    std::array<Zone, maxZones_> lastZones_{};
+    std::size_t zoneCount_ = 0;
+    std::size_t lastZoneCount_ = 0;
+    std::array<std::atomic<std::size_t>, CounterCount> counters_{};
+    std::vector<TraceEvent> trace_;
+    bool capturing_ = false;
+    mutable std::mutex mutex_;
+};
+
+// Times the enclosing block; name must be a string literal (zones are keyed by pointer)
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : name_(name), start_(Profiler::Clock::now()) {
     }
 
-    void handleEvent(const sf::Event& event, CommandQueue& commands) {
-        if (const auto* keyPressed = event.getIf<sf::Event::KeyPressed>()) {
-            if (keyPressed->scancode == sf::Keyboard::Scancode::P) {
-                Command output;
-                output.category_ = Category::PlayerAircraft;
-                output.action_ = [](SceneNode& s, sf::Time) {
-                    std::cout << s.getPosition().x << ","
-                        << s.getPosition().y << "\n";
-                    };
-                commands.emplace(std::move(output));
+    ~ProfileScope() {
+        Profiler::instance().record(name_, start_, Profiler::Clock::now());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_;
+    Profiler::Clock::time_point start_;
+};
+
+// Read-only view of a whole file, mapped into memory for as long as this object lives
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path) {
+#if defined(_WIN32)
+        file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER size{};
+        if (file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+            close();
+            throw std::runtime_error("Can't open file for mapping: " + path.string());
+        }
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void* view = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!view) {
+            close();
+            throw std::runtime_error("Can't map file: " + path.string());
+        }
+        data_ = static_cast<const std::byte*>(view);
+        size_ = static_cast<std::size_t>(size.QuadPart);
+#else
+        const int descriptor = ::open(path.c_str(), O_RDONLY);
+        struct stat status {};
+        if (descriptor < 0 || ::fstat(descriptor, &status) != 0 || status.st_size == 0) {
+            if (descriptor >= 0) {
+                ::close(descriptor);
             }
+            throw std::runtime_error("Can't open file for mapping: " + path.string());
+        }
+        void* view = ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);
+        if (view == MAP_FAILED) {
+            throw std::runtime_error("Can't map file: " + path.string());
         }
+        ::madvise(view, static_cast<std::size_t>(status.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const std::byte*>(view);
+        size_ = static_cast<std::size_t>(status.st_size);
+#endif
     }
 
-    static bool isRealtimeAction(const std::string& id) {
-        return (id == "MoveUp" || id == "MoveDown" || id == "MoveRight" || id == "MoveLeft");
+    ~MappedFile() {
+        close();
     }
 
-    void handleRealtimeInput(CommandQueue& c) {
-        for (const auto& [key, id] : keys_) {
-            if (sf::Keyboard::isKeyPressed(key) && isRealtimeAction(id)) {
-                c.emplace(commands_[id]);
-            }
-        }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const std::byte> getBytes() const {
+        return { data_, size_ };
     }
 
 private:
-    std::unordered_map<sf::Keyboard::Key, std::string> keys_;
-    std::unordered_map<std::string, Command> commands_;
+    void close() {
+#if defined(_WIN32)
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_) {
+            CloseHandle(mapping_);
+        }
+        if (file_ && file_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_);
+        }
+        file_ = mapping_ = nullptr;
+#else
+        if (data_) {
+            ::munmap(const_cast<std::byte*>(data_), size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+#if defined(_WIN32)
+    HANDLE file_ = nullptr;
+    HANDLE mapping_ = nullptr;
+#endif
 };
 
+// Every manifest entry in one file, mapped once and kept for the whole process,
+// so loaders get zero-copy spans and fonts can stream straight from the mapping.
+// Layout, little-endian: "SSPK", u32 version, u32 entry count, then per entry
+// u64 offset, u64 size, u16 path length and the path; then the payloads (the
+// original file bytes), each 16-byte aligned. Build one with --pack.
+class AssetPack {
+public:
+    static constexpr std::array<char, 4> magic = { 'S', 'S', 'P', 'K' };
+    static constexpr std::uint32_t version = 1;
+
+    static AssetPack& instance() {
+        static AssetPack pack;
+        return pack;
+    }
+
+    // False if there is no pack at path; loaders then keep reading loose files.
+    // Call before anything is loaded.
+    bool mount(const std::filesystem::path& path) {
+        if (!std::filesystem::exists(path)) {
+            return false;
+        }
+        file_ = std::make_unique<MappedFile>(path);
+        const std::span<const std::byte> bytes = file_->getBytes();
+        const auto fail = [&path]() -> std::runtime_error {
+            return std::runtime_error("Corrupt asset pack: " + path.string());
+        };
+
+        std::size_t cursor = 0;
+        const auto read = [&](std::size_t count) {
+            if (bytes.size() - cursor < count) {
+                throw fail();
+            }
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                value |= static_cast<std::uint64_t>(bytes[cursor + i]) << (8 * i);
+            }
+            cursor += count;
+            return value;
+        };
+
+        if (bytes.size() < magic.size() || std::memcmp(bytes.data(), magic.data(), magic.size()) != 0) {
+            throw fail();
+        }
+        cursor = magic.size();
+        if (read(4) != version) {
+            throw fail();
+        }
+
+        const std::uint64_t entryCount = read(4);
+        for (std::uint64_t i = 0; i < entryCount; ++i) {
+            const std::uint64_t offset = read(8);
+            const std::uint64_t size = read(8);
+            const std::size_t pathLength = static_cast<std::size_t>(read(2));
+            if (bytes.size() - cursor < pathLength || offset > bytes.size() || size > bytes.size() - offset) {
+                throw fail();
+            }
+            const std::string_view entryPath(reinterpret_cast<const char*>(bytes.data() + cursor), pathLength);
+            cursor += pathLength;
+
+            const std::span<const std::byte> payload = bytes.subspan(static_cast<std::size_t>(offset), static_cast<std::size_t>(size));
+            const auto match = [&](const auto& paths, auto& slots) {
+                const auto it = std::ranges::find(paths, entryPath);
+                if (it == paths.end()) {
+                    return false;
+                }
+                slots[static_cast<std::size_t>(it - paths.begin())] = payload;
+                return true;
+            };
+            match(Assets::texturePaths, textures_) || match(Assets::fontPaths, fonts_) || match(Assets::levelPaths, levels_)
+                || match(Assets::soundPaths, sounds_) || match(Assets::musicPaths, music_);
+        }
+        return true;
+    }
+
+    bool isMounted() const {
+        return file_ != nullptr;
+    }
+
+    // Empty when the pack isn't mounted or doesn't contain the asset
+    std::span<const std::byte> find(Textures::ID id) const {
+        return textures_[id];
+    }
+
+    std::span<const std::byte> find(Fonts::ID id) const {
+        return fonts_[id];
+    }
+
+    std::span<const std::byte> find(Levels::ID id) const {
+        return levels_[id];
+    }
+
+    std::span<const std::byte> find(SoundEffects::ID id) const {
+        return sounds_[id];
+    }
+
+    std::span<const std::byte> find(Music::ID id) const {
+        return music_[id];
+    }
+
+    // Packs every manifest entry, read from loose files under root; missing audio is left out
+    static void write(const std::filesystem::path& output, const std::filesystem::path& root = ".") {
+        std::vector<std::string_view> paths(Assets::texturePaths.begin(), Assets::texturePaths.end());
+        paths.insert(paths.end(), Assets::fontPaths.begin(), Assets::fontPaths.end());
+        paths.insert(paths.end(), Assets::levelPaths.begin(), Assets::levelPaths.end());
+        for (const auto audio : { std::span<const std::string_view>(Assets::soundPaths), std::span<const std::string_view>(Assets::musicPaths) }) {
+            std::ranges::copy_if(audio, std::back_inserter(paths),
+                [&root](std::string_view path) { return std::filesystem::exists(root / path); });
+        }
+
+        std::vector<std::string> payloads;
+        for (const std::string_view path : paths) {
+            std::ifstream file(root / path, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Can't read asset for packing: " + (root / path).string());
+            }
+            payloads.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        constexpr std::size_t alignment = 16;
+        const auto align = [](std::size_t offset) {
+            return (offset + alignment - 1) & ~(alignment - 1);
+        };
+        std::size_t offset = magic.size() + 8;
+        for (const std::string_view path : paths) {
+            offset += 8 + 8 + 2 + path.size();
+        }
+
+        std::ofstream file(output, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Can't write asset pack: " + output.string());
+        }
+        const auto put = [&file](std::uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; ++i) {
+                file.put(static_cast<char>((value >> (8 * i)) & 0xFFu));
+            }
+        };
+
+        file.write(magic.data(), magic.size());
+        put(version, 4);
+        put(paths.size(), 4);
+        std::vector<std::size_t> offsets;
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            offset = align(offset);
+            offsets.push_back(offset);
+            put(offset, 8);
+            put(payloads[i].size(), 8);
+            put(paths[i].size(), 2);
+            file.write(paths[i].data(), static_cast<std::streamsize>(paths[i].size()));
+            offset += payloads[i].size();
+        }
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            while (static_cast<std::size_t>(file.tellp()) < offsets[i]) {
+                file.put('\0');
+            }
+            file.write(payloads[i].data(), static_cast<std::streamsize>(payloads[i].size()));
+        }
+        if (!file) {
+            throw std::runtime_error("Can't write asset pack: " + output.string());
+        }
+    }
+
+private:
+    AssetPack() = default;
+
+    std::unique_ptr<MappedFile> file_;
+    std::array<std::span<const std::byte>, Textures::Count> textures_{};
+    std::array<std::span<const std::byte>, Fonts::Count> fonts_{};
+    std::array<std::span<const std::byte>, Levels::Count> levels_{};
+    std::array<std::span<const std::byte>, SoundEffects::Count> sounds_{};
+    std::array<std::span<const std::byte>, Music::Count> music_{};
+};
+
+template<typename T>
+concept LoadableFromFile = requires(T t, const std::filesystem::path & path) {
+    { t.loadFromFile(path) } -> std::convertible_to<bool>;
+};
+
+template<typename T>
+concept LoadableFromMemory = requires(T t, const void* data, std::size_t size) {
+    { t.loadFromMemory(data, size) } -> std::convertible_to<bool>;
+};
+
+// Resources are reference counted but stay resident when the count drops to zero,
+// so they are read from disk once per process and survive state transitions.
+// Call purgeUnused() to actually free anything nobody holds any more.
+// Slots are indexed by the manifest id, so get() is a plain array access.
+template <LoadableFromFile T, typename Id>
+    requires LoadableFromMemory<T>
+class ResourceManager {
+public:
+    T& load(Id id) {
+        Entry& entry = entries_[id];
+        if (entry.resource_) {
+            ++entry.refCount_;
+            return *entry.resource_;
+        }
+
+        const std::filesystem::path path(Assets::getPath(id));
+        const std::span<const std::byte> packed = AssetPack::instance().find(id);
+        std::unique_ptr<T> resource = std::make_unique<T>();
+        if (packed.empty() ? !resource->loadFromFile(path) : !resource->loadFromMemory(packed.data(), packed.size())) {
+            throw std::runtime_error("Can't load resource from file: " + path.string());
+        }
+        entry.resource_ = std::move(resource);
+        entry.refCount_ = 1;
+        return *entry.resource_;
+    }
+
+    // Adopts an already constructed resource (e.g. uploaded by a loader) as resident but unreferenced
+    T& insert(Id id, std::unique_ptr<T> resource) {
+        Entry& entry = entries_[id];
+        if (!entry.resource_) {
+            entry.resource_ = std::move(resource);
+        }
+        return *entry.resource_;
+    }
+
+    void release(Id id) {
+        assert(entries_[id].resource_ && "Resource not found.");
+        assert(entries_[id].refCount_ > 0 && "Resource released more often than loaded.");
+        --entries_[id].refCount_;
+    }
+
+    void purgeUnused() {
+        for (Entry& entry : entries_) {
+            if (entry.refCount_ == 0) {
+                entry.resource_.reset();
+            }
+        }
+    }
+
+    bool isLoaded(Id id) const {
+        return entries_[id].resource_ != nullptr;
+    }
+
+    std::size_t getRefCount(Id id) const {
+        return entries_[id].refCount_;
+    }
+
+    T& get(Id id) const {
+        assert(entries_[id].resource_ && "Resource not found.");
+        return *entries_[id].resource_;
+    }
+
+private:
+    struct Entry {
+        std::unique_ptr<T> resource_;
+        std::size_t refCount_ = 0;
+    };
+
+    std::array<Entry, Id::Count> entries_;
+};
+
+// Collects textured quads during scene traversal and draws them with one
+// call per (layer, texture) pair. Layers are drawn in ascending order; within
+// a layer, batches draw in the order their texture was first pushed that
+// frame, and quads that share a layer and texture keep their submission order.
+// Quads batched under different textures of one layer don't keep their
+// relative order, so anything that must overlap predictably needs its own layer.
+class RenderQueue {
+public:
+    void push(unsigned int layer, const sf::Texture& texture, const sf::Transform& transform,
+        const sf::IntRect& rect, sf::Color color = sf::Color::White) {
+        sf::VertexArray& vertices = getBatch(layer, &texture);
+
+        const sf::Vector2f size(std::abs(static_cast<float>(rect.size.x)), std::abs(static_cast<float>(rect.size.y)));
+        const sf::Vector2f texLeftTop(rect.position);
+        const sf::Vector2f texRightBottom = texLeftTop + sf::Vector2f(rect.size);
+
+        const sf::Vertex leftTop{ transform.transformPoint({ 0.f, 0.f }), color, texLeftTop };
+        const sf::Vertex rightTop{ transform.transformPoint({ size.x, 0.f }), color, { texRightBottom.x, texLeftTop.y } };
+        const sf::Vertex leftBottom{ transform.transformPoint({ 0.f, size.y }), color, { texLeftTop.x, texRightBottom.y } };
+        const sf::Vertex rightBottom{ transform.transformPoint(size), color, texRightBottom };
+
+        appendQuad(vertices, leftTop, rightTop, leftBottom, rightBottom);
+    }
+
+    // Untextured, axis-aligned quad; every one on a layer shares a single vertex array
+    void push(unsigned int layer, const sf::FloatRect& rect, sf::Color color) {
+        sf::VertexArray& vertices = getBatch(layer, nullptr);
+        const sf::Vector2f rightBottom = rect.position + rect.size;
+        appendQuad(vertices, { rect.position, color, {} }, { { rightBottom.x, rect.position.y }, color, {} },
+            { { rect.position.x, rightBottom.y }, color, {} }, { rightBottom, color, {} });
+    }
+
+    // Appends prebuilt quads (six vertices each, in local space) under one transform
+    void append(unsigned int layer, const sf::Texture& texture, std::span<const sf::Vertex> quads,
+        const sf::Transform& transform = sf::Transform::Identity) {
+        assert(quads.size() % 6 == 0 && "Quads are six vertices each");
+        sf::VertexArray& vertices = getBatch(layer, &texture);
+        for (sf::Vertex vertex : quads) {
+            vertex.position = transform.transformPoint(vertex.position);
+            vertices.append(vertex);
+        }
+        quadCount_ += quads.size() / 6;
+    }
+
+    // Draws every non-empty batch and empties the queue, keeping vertex storage for the next frame
+    void draw(sf::RenderTarget& target, sf::RenderStates states = sf::RenderStates::Default) {
+        drawCalls_ = 0;
+        for (Layer& layer : layers_) {
+            for (std::size_t i = 0; i < layer.used_; ++i) {
+                Batch& batch = layer.batches_[i];
+                if (batch.vertices_.getVertexCount() == 0) {
+                    continue;
+                }
+                states.texture = batch.texture_;
+                target.draw(batch.vertices_, states);
+                batch.vertices_.clear();
+                ++drawCalls_;
+            }
+            layer.used_ = 0;
+        }
+        lastBatch_ = noBatch;
+        lastQuadCount_ = std::exchange(quadCount_, 0);
+    }
+
+    std::size_t getDrawCallCount() const {
+        return drawCalls_;
+    }
+
+    std::size_t getQuadCount() const {
+        return lastQuadCount_;
+    }
+
+    // Subtrees whose world bounds miss this rectangle are skipped during collection
+    void setCullRect(const std::optional<sf::FloatRect>& rect) {
+        cullRect_ = rect;
+    }
+
+    bool isCulled(const sf::FloatRect& worldBounds) const {
+        return cullRect_ && !cullRect_->findIntersection(worldBounds);
+    }
+
+private:
+    struct Batch {
+        const sf::Texture* texture_;
+        sf::VertexArray vertices_{ sf::PrimitiveType::Triangles };
+    };
+
+    // The first used_ batches are this frame's, in submission order; the rest are
+    // idle storage kept from earlier frames
+    struct Layer {
+        std::vector<Batch> batches_;
+        std::size_t used_ = 0;
+    };
+
+    // A null texture is the untextured batch. Runs of pushes to the same batch,
+    // the common case for sprites sharing an atlas page, skip the lookup entirely.
+    sf::VertexArray& getBatch(unsigned int layer, const sf::Texture* texture) {
+        if (lastBatch_ != noBatch && lastLayer_ == layer) {
+            Batch& last = layers_[layer].batches_[lastBatch_];
+            if (last.texture_ == texture) {
+                return last.vertices_;
+            }
+        }
+
+        if (layer >= layers_.size()) {
+            layers_.resize(layer + 1);
+        }
+        Layer& entry = layers_[layer];
+        const auto begin = entry.batches_.begin();
+        auto it = std::find_if(begin, begin + entry.used_, [texture](const Batch& batch) {
+            return batch.texture_ == texture;
+            });
+        if (it == begin + entry.used_) {
+            it = std::find_if(it, entry.batches_.end(), [texture](const Batch& batch) {
+                return batch.texture_ == texture;
+                });
+            if (it == entry.batches_.end()) {
+                entry.batches_.push_back({ texture });
+                it = std::prev(entry.batches_.end());
+            }
+            std::swap(*it, entry.batches_[entry.used_]);
+            it = entry.batches_.begin() + entry.used_++;
+        }
+
+        lastLayer_ = layer;
+        lastBatch_ = static_cast<std::size_t>(it - entry.batches_.begin());
+        return it->vertices_;
+    }
+
+    void appendQuad(sf::VertexArray& vertices, const sf::Vertex& leftTop, const sf::Vertex& rightTop,
+        const sf::Vertex& leftBottom, const sf::Vertex& rightBottom) {
+        vertices.append(leftTop);
+        vertices.append(rightTop);
+        vertices.append(leftBottom);
+        vertices.append(leftBottom);
+        vertices.append(rightTop);
+        vertices.append(rightBottom);
+        ++quadCount_;
+    }
+
+    static constexpr std::size_t noBatch = std::numeric_limits<std::size_t>::max();
+
+    std::vector<Layer> layers_;
+    unsigned int lastLayer_ = 0;
+    std::size_t lastBatch_ = noBatch;
+    std::optional<sf::FloatRect> cullRect_;
+    std::size_t quadCount_ = 0;
+    std::size_t lastQuadCount_ = 0;
+    std::size_t drawCalls_ = 0;
+};
+
+// Move-only callable stored inline in a fixed buffer; never touches the heap.
+// Callables that don't fit are rejected at compile time. clone() copies the
+// stored callable in place when it is copy-constructible.
+template <typename Signature, std::size_t Capacity = 32>
+class InlineFunction;
+
+template <typename R, typename... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+public:
+    InlineFunction() noexcept = default;
+
+    InlineFunction(std::nullptr_t) noexcept {}
+
+    template <typename F>
+        requires (!std::same_as<std::remove_cvref_t<F>, InlineFunction> && std::invocable<std::decay_t<F>&, Args...>)
+    InlineFunction(F&& f) {
+        construct(std::forward<F>(f));
+    }
+
+    InlineFunction(InlineFunction&& other) noexcept {
+        moveFrom(other);
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    InlineFunction& operator=(InlineFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    template <typename F>
+        requires (!std::same_as<std::remove_cvref_t<F>, InlineFunction> && std::invocable<std::decay_t<F>&, Args...>)
+    InlineFunction& operator=(F&& f) {
+        reset();
+        construct(std::forward<F>(f));
+        return *this;
+    }
+
+    InlineFunction& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    ~InlineFunction() {
+        reset();
+    }
+
+    R operator()(Args... args) const {
+        assert(ops_ && "Calling an empty InlineFunction");
+        return ops_->invoke(storage_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept {
+        return ops_ != nullptr;
+    }
+
+    InlineFunction clone() const {
+        InlineFunction result;
+        if (ops_) {
+            assert(ops_->copy && "Stored callable is not copyable");
+            ops_->copy(result.storage_, storage_);
+            result.ops_ = ops_;
+        }
+        return result;
+    }
+
+private:
+    struct Ops {
+        R(*invoke)(void*, Args&&...);
+        void (*move)(void*, void*);
+        void (*copy)(void*, const void*);
+        void (*destroy)(void*);
+    };
+
+    template <typename F>
+    static constexpr void (*copyOp())(void*, const void*) {
+        if constexpr (std::is_copy_constructible_v<F>) {
+            return [](void* dst, const void* src) {
+                ::new (dst) F(*static_cast<const F*>(src));
+                };
+        }
+        else {
+            return nullptr;
+        }
+    }
+
+    template <typename F>
+    static constexpr Ops opsFor = {
+        [](void* f, Args&&... args) -> R {
+            return std::invoke(*static_cast<F*>(f), std::forward<Args>(args)...);
+        },
+        [](void* dst, void* src) {
+            ::new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        },
+        copyOp<F>(),
+        [](void* f) {
+            static_cast<F*>(f)->~F();
+        },
+    };
+
+    template <typename F>
+    void construct(F&& f) {
+        using Stored = std::decay_t<F>;
+        static_assert(sizeof(Stored) <= Capacity, "Callable too large for InlineFunction");
+        static_assert(alignof(Stored) <= alignof(std::max_align_t), "Callable over-aligned for InlineFunction");
+        static_assert(std::is_nothrow_move_constructible_v<Stored>, "Callable must be nothrow movable");
+        ::new (static_cast<void*>(storage_)) Stored(std::forward<F>(f));
+        ops_ = &opsFor<Stored>;
+    }
+
+    void moveFrom(InlineFunction& other) noexcept {
+        if (other.ops_) {
+            other.ops_->move(storage_, other.storage_);
+            ops_ = std::exchange(other.ops_, nullptr);
+        }
+    }
+
+    void reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) mutable std::byte storage_[Capacity];
+    const Ops* ops_ = nullptr;
+};
+
+// Fixed pool of workers for data-parallel loops. parallelFor() cuts the index
+// range into chunks and deals each participant (every worker plus the caller)
+// a contiguous run of them. Participants take chunks from the front of their
+// own run and, once it is empty, steal single chunks from the back of others'.
+// Runs are packed (begin, end) words updated by CAS, so nothing is allocated
+// or locked per chunk. One parallelFor() at a time, from a single thread.
+class JobSystem {
+public:
+    explicit JobSystem(unsigned int workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1)
+        : runs_(workerCount + 1), count_(0), grain_(1), remaining_(0), generation_(0) {
+        workers_.reserve(workerCount);
+        for (unsigned int i = 0; i < workerCount; ++i) {
+            workers_.emplace_back([this, i](std::stop_token stop) {
+                work(stop, i);
+                });
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int getWorkerCount() const {
+        return static_cast<unsigned int>(workers_.size());
+    }
+
+    // Calls fn(begin, end) over [0, count) in chunks of at most grain indices and
+    // returns once every chunk has run. fn must not throw.
+    template <typename Fn>
+    void parallelFor(std::size_t count, std::size_t grain, Fn&& fn) {
+        grain = std::max<std::size_t>(grain, 1);
+        if (workers_.empty() || count <= grain) {
+            if (count > 0) {
+                fn(std::size_t{ 0 }, count);
+            }
+            return;
+        }
+
+        const std::size_t chunks = (count + grain - 1) / grain;
+        assert(chunks <= std::numeric_limits<std::uint32_t>::max() && "Too many chunks");
+        task_ = [&fn](std::size_t begin, std::size_t end) {
+            fn(begin, end);
+            };
+        count_ = count;
+        grain_ = grain;
+        remaining_.store(chunks, std::memory_order_relaxed);
+
+        const std::size_t participants = runs_.size();
+        for (std::size_t i = 0; i < participants; ++i) {
+            const auto first = static_cast<std::uint32_t>(chunks * i / participants);
+            const auto last = static_cast<std::uint32_t>(chunks * (i + 1) / participants);
+            runs_[i].chunks_.store(pack(first, last), std::memory_order_release);
+        }
+        {
+            std::scoped_lock lock(mutex_);
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        // The caller is the last participant; it works instead of blocking
+        drain(participants - 1);
+        while (remaining_.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    struct alignas(64) Run {
+        std::atomic<std::uint64_t> chunks_{ 0 };
+    };
+
+    static std::uint64_t pack(std::uint32_t begin, std::uint32_t end) {
+        return (static_cast<std::uint64_t>(begin) << 32) | end;
+    }
+
+    static bool popFront(Run& run, std::uint32_t& chunk) {
+        std::uint64_t value = run.chunks_.load(std::memory_order_acquire);
+        for (;;) {
+            const auto begin = static_cast<std::uint32_t>(value >> 32);
+            const auto end = static_cast<std::uint32_t>(value);
+            if (begin >= end) {
+                return false;
+            }
+            if (run.chunks_.compare_exchange_weak(value, pack(begin + 1, end), std::memory_order_acq_rel)) {
+                chunk = begin;
+                return true;
+            }
+        }
+    }
+
+    static bool popBack(Run& run, std::uint32_t& chunk) {
+        std::uint64_t value = run.chunks_.load(std::memory_order_acquire);
+        for (;;) {
+            const auto begin = static_cast<std::uint32_t>(value >> 32);
+            const auto end = static_cast<std::uint32_t>(value);
+            if (begin >= end) {
+                return false;
+            }
+            if (run.chunks_.compare_exchange_weak(value, pack(begin, end - 1), std::memory_order_acq_rel)) {
+                chunk = end - 1;
+                return true;
+            }
+        }
+    }
+
+    void execute(std::uint32_t chunk) {
+        const std::size_t begin = chunk * grain_;
+        task_(begin, std::min(begin + grain_, count_));
+        remaining_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    // Own run first, then steal until every run is empty
+    void drain(std::size_t self) {
+        std::uint32_t chunk;
+        while (popFront(runs_[self], chunk)) {
+            execute(chunk);
+        }
+        for (bool stole = true; stole;) {
+            stole = false;
+            for (std::size_t offset = 1; offset < runs_.size(); ++offset) {
+                if (popBack(runs_[(self + offset) % runs_.size()], chunk)) {
+                    execute(chunk);
+                    stole = true;
+                }
+            }
+        }
+    }
+
+    void work(std::stop_token stop, std::size_t self) {
+        std::uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock lock(mutex_);
+                if (!wake_.wait(lock, stop, [&] { return generation_ != seen; })) {
+                    return;
+                }
+                seen = generation_;
+            }
+            drain(self);
+        }
+    }
+
+    std::vector<Run> runs_;
+    InlineFunction<void(std::size_t, std::size_t)> task_;
+    std::size_t count_;
+    std::size_t grain_;
+    std::atomic<std::size_t> remaining_;
+    std::uint64_t generation_;
+    std::mutex mutex_;
+    std::condition_variable_any wake_;
+    std::vector<std::jthread> workers_;
+};
+
+class SceneNode;
+
+struct Command {
+    InlineFunction<void(SceneNode&, sf::Time)> action_;
+    unsigned int category_ = Category::None;
+
+    Command clone() const {
+        return { action_.clone(), category_ };
+    }
+};
+
+// Per-category lists of attached nodes, so a command only visits the nodes it targets.
+// SceneNode keeps it up to date in addChild/detachChild. Each node owns a Slots
+// array holding its position in every list it is in, so removal is a swap with
+// the list's last entry rather than a search.
+class CategoryIndex {
+public:
+    static constexpr std::size_t maxCategoriesPerNode = 4;
+    using Slots = std::array<std::uint32_t, maxCategoriesPerNode>;
+
+    void add(SceneNode* node, unsigned int category, Slots& slots) {
+        assert(std::popcount(category) <= static_cast<int>(maxCategoriesPerNode) && "Too many categories on one node");
+        forEachBit(category, [&](std::size_t bit) {
+            slots[rank(category, bit)] = static_cast<std::uint32_t>(nodes_[bit].size());
+            nodes_[bit].push_back({ node, category, &slots });
+            });
+    }
+
+    void remove(SceneNode* node, unsigned int category, const Slots& slots) {
+        forEachBit(category, [&](std::size_t bit) {
+            auto& entries = nodes_[bit];
+            const std::uint32_t slot = slots[rank(category, bit)];
+            assert(slot < entries.size() && entries[slot].node_ == node && "Node not indexed");
+            entries[slot] = entries.back();
+            (*entries[slot].slots_)[rank(entries[slot].category_, bit)] = slot;
+            entries.pop_back();
+            });
+    }
+
+    void dispatch(const Command& command, sf::Time dt) const {
+        forEach(command.category_, [&](SceneNode& node) {
+            command.action_(node, dt);
+            });
+    }
+
+    // Visits every node in any category of mask exactly once
+    template <typename Fn>
+    void forEach(unsigned int mask, Fn&& fn) const {
+        forEachBit(mask, [&](std::size_t bit) {
+            for (const auto& entry : nodes_[bit]) {
+                // A node in several requested categories is only visited for the lowest one
+                const unsigned int shared = entry.category_ & mask;
+                if ((shared & (0u - shared)) == (1u << bit)) {
+                    fn(*entry.node_);
+                }
+            }
+            });
+    }
+
+    std::size_t getNodeCount(unsigned int category) const {
+        std::size_t count = 0;
+        forEachBit(category, [&](std::size_t bit) {
+            count += nodes_[bit].size();
+            });
+        return count;
+    }
+
+private:
+    struct Entry {
+        SceneNode* node_;
+        unsigned int category_;
+        Slots* slots_;
+    };
+
+    // Where bit's slot lives among the node's categories
+    static std::size_t rank(unsigned int category, std::size_t bit) {
+        return static_cast<std::size_t>(std::popcount(category & ((1u << bit) - 1u)));
+    }
+
+    template <typename Fn>
+    static void forEachBit(unsigned int mask, Fn&& fn) {
+        while (mask != 0) {
+            fn(static_cast<std::size_t>(std::countr_zero(mask)));
+            mask &= mask - 1;
+        }
+    }
+
+    std::array<std::vector<Entry>, 32> nodes_;
+};
+
+// Deleter for SceneNode::Ptr. Nodes made by a NodePool return their memory to
+// it; a null resource means the node came from plain new.
+struct NodeDeleter {
+    std::pmr::memory_resource* resource_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t alignment_ = 0;
+
+    template <typename T>
+    void operator()(T* node) const {
+        if (!resource_) {
+            delete node;
+            return;
+        }
+        void* memory = dynamic_cast<void*>(node);
+        node->~T();
+        resource_->deallocate(memory, size_, alignment_);
+    }
+};
+
+// The transform base is private so the dirty-tracking setters below are the
+// only way to move a node; nothing can reach sf::Transformable's own setters.
+class SceneNode : private sf::Transformable, public sf::Drawable {
+public:
+    using Ptr = std::unique_ptr<SceneNode, NodeDeleter>;
+
+    using sf::Transformable::getPosition;
+    using sf::Transformable::getRotation;
+    using sf::Transformable::getScale;
+    using sf::Transformable::getOrigin;
+    using sf::Transformable::getTransform;
+    using sf::Transformable::getInverseTransform;
+
+    SceneNode()
+        : parent_(nullptr), index_(nullptr), jobs_(nullptr), boundsDirty_(true), worldTransformDirty_(true),
+        removalPending_(false), wrecksBelow_(false), stableOrder_(true) {
+    }
+
+    void addChild(Ptr child) {
+        child->parent_ = this;
+        child->markWorldTransformDirty();
+        if (index_) {
+            child->attachIndex(index_);
+        }
+        children_.emplace_back(std::move(child));
+        markBoundsDirty();
+    }
+
+    // Every transform change goes through here so cached bounds and world transforms know when a node moved
+    void setPosition(sf::Vector2f position) {
+        sf::Transformable::setPosition(position);
+        onTransformChanged();
+    }
+
+    void move(sf::Vector2f offset) {
+        sf::Transformable::move(offset);
+        onTransformChanged();
+    }
+
+    void setRotation(sf::Angle angle) {
+        sf::Transformable::setRotation(angle);
+        onTransformChanged();
+    }
+
+    void rotate(sf::Angle angle) {
+        sf::Transformable::rotate(angle);
+        onTransformChanged();
+    }
+
+    void setScale(sf::Vector2f factors) {
+        sf::Transformable::setScale(factors);
+        onTransformChanged();
+    }
+
+    void scale(sf::Vector2f factor) {
+        sf::Transformable::scale(factor);
+        onTransformChanged();
+    }
+
+    void setOrigin(sf::Vector2f origin) {
+        sf::Transformable::setOrigin(origin);
+        onTransformChanged();
+    }
+
+    // Bounds of this node and everything below it, in the parent's coordinate space.
+    // Cached; only recomputed after this node or a descendant changed.
+    const sf::FloatRect& getSubtreeBounds() const {
+        if (boundsDirty_) {
+            std::optional<sf::FloatRect> bounds;
+            const auto merge = [&bounds](const sf::FloatRect& rect) {
+                if (rect.size.x <= 0.f && rect.size.y <= 0.f) {
+                    return;
+                }
+                if (!bounds) {
+                    bounds = rect;
+                    return;
+                }
+                const sf::Vector2f leftTop(std::min(bounds->position.x, rect.position.x), std::min(bounds->position.y, rect.position.y));
+                const sf::Vector2f rightBottom(
+                    std::max(bounds->position.x + bounds->size.x, rect.position.x + rect.size.x),
+                    std::max(bounds->position.y + bounds->size.y, rect.position.y + rect.size.y));
+                bounds = sf::FloatRect(leftTop, rightBottom - leftTop);
+            };
+
+            merge(getDrawBounds());
+            for (const auto& child : children_) {
+                merge(child->getSubtreeBounds());
+            }
+            subtreeBounds_ = bounds ? getTransform().transformRect(*bounds) : sf::FloatRect(getPosition(), {});
+            boundsDirty_ = false;
+        }
+        return subtreeBounds_;
+    }
+
+    // Set on the root; nodes attached below it register themselves
+    void setCategoryIndex(CategoryIndex* index) {
+        if (index_) {
+            detachIndex();
+        }
+        if (index) {
+            attachIndex(index);
+        }
+    }
+
+    Ptr detachChild(const SceneNode& node) {
+        auto it = std::ranges::find_if(children_,
+            [&](const Ptr& child) {
+                return child.get() == &node;
+            });
+
+        assert(it != children_.end() && "Child not found");
+
+        Ptr result = std::move(*it);
+        result->parent_ = nullptr;
+        result->markWorldTransformDirty();
+        if (result->index_) {
+            result->detachIndex();
+        }
+        children_.erase(it);
+        markBoundsDirty();
+        return result;
+    }
+
+    void update(const sf::Time& dt) {
+        updateCurrent(dt);
+        updateChildren(dt);
+    }
+
+    // Flags this node (and its subtree) to be dropped by the next removeWrecks() pass
+    void markForRemoval() {
+        removalPending_ = true;
+        for (SceneNode* node = parent_; node != nullptr && !node->wrecksBelow_; node = node->parent_) {
+            node->wrecksBelow_ = true;
+        }
+    }
+
+    bool isMarkedForRemoval() const {
+        return removalPending_;
+    }
+
+    // Updates this node's children on the job system when there are enough of them.
+    // Only for layers whose children's updateCurrent() touches nothing but their
+    // own subtree: no commands, no markForRemoval(), no reaching into siblings.
+    void setParallelUpdate(JobSystem* jobs) {
+        jobs_ = jobs;
+    }
+
+    // Stable layers keep their draw order on removal; others swap-and-pop
+    void setStableOrder(bool stable) {
+        stableOrder_ = stable;
+    }
+
+    // Drops every marked node in one pass per child list; only visits subtrees that have wrecks
+    void removeWrecks() {
+        if (!wrecksBelow_) {
+            return;
+        }
+        wrecksBelow_ = false;
+
+        const auto release = [this](Ptr& child) {
+            if (child->index_) {
+                child->detachIndex();
+            }
+            child->parent_ = nullptr;
+            child.reset();
+        };
+
+        if (stableOrder_) {
+            std::erase_if(children_, [&](Ptr& child) {
+                if (!child->removalPending_) {
+                    return false;
+                }
+                release(child);
+                return true;
+                });
+        }
+        else {
+            for (std::size_t i = 0; i < children_.size();) {
+                if (children_[i]->removalPending_) {
+                    release(children_[i]);
+                    children_[i] = std::move(children_.back());
+                    children_.pop_back();
+                }
+                else {
+                    ++i;
+                }
+            }
+        }
+
+        for (auto& child : children_) {
+            child->removeWrecks();
+        }
+        markBoundsDirty();
+    }
+
+    // Remember where every node was at the start of a tick so draw can blend towards the current state
+    void savePreviousState() {
+        previousPosition_ = getPosition();
+        for (auto& child : children_) {
+            child->savePreviousState();
+        }
+    }
+
+    // Draw with the transform blended between the previous and current tick (alpha in [0, 1])
+    void render(sf::RenderTarget& target, sf::RenderStates states, float alpha) const {
+        states.transform *= getInterpolatedTransform(alpha);
+        drawCurrent(target, states);
+        for (const auto& child : children_) {
+            child->render(target, states, alpha);
+        }
+    }
+
+    // Batched counterpart of render(): nodes submit quads instead of drawing directly.
+    // A node without an explicit render layer inherits its parent's.
+    void collect(RenderQueue& queue, sf::Transform transform, float alpha, unsigned int layer = 0) const {
+        if (renderLayer_) {
+            layer = *renderLayer_;
+        }
+        if (queue.isCulled(transform.transformRect(getSubtreeBounds()))) {
+            return;
+        }
+        transform *= getInterpolatedTransform(alpha);
+        batchCurrent(queue, transform, layer);
+        for (const auto& child : children_) {
+            child->collect(queue, transform, alpha, layer);
+        }
+    }
+
+    void setRenderLayer(unsigned int layer) {
+        renderLayer_ = layer;
+    }
+
+    void onCommand(const Command& command, const sf::Time& dt) {
+        if (command.category_ & getCategory()) {
+            command.action_(*this, dt);
+        }
+
+        for (auto& child : children_) {
+            child->onCommand(command, dt);
+        }
+    }
+
+    virtual unsigned int getCategory() const {
+        return Category::Scene;
+    }
+
+    // World-space bounds used for collision queries; empty for nodes that can't collide
+    virtual sf::FloatRect getBoundingRect() const {
+        return {};
+    }
+
+    // Cached; recomputed only after this node or one of its ancestors moved
+    const sf::Transform& getWorldTransform() const {
+        if (worldTransformDirty_) {
+            worldTransform_ = parent_ ? parent_->getWorldTransform() * getTransform() : getTransform();
+            worldTransformDirty_ = false;
+        }
+        return worldTransform_;
+    }
+
+    sf::Vector2f getWorldPosition() const {
+        return getWorldTransform() * sf::Vector2f();
+    }
+
+protected:
+    // Local-space bounds of what drawCurrent/batchCurrent draw
+    virtual sf::FloatRect getDrawBounds() const {
+        return {};
+    }
+
+    void onTransformChanged() {
+        markBoundsDirty();
+        markWorldTransformDirty();
+    }
+
+    // A clean world transform implies clean ancestors, so a dirty node's subtree is already dirty
+    void markWorldTransformDirty() {
+        if (worldTransformDirty_) {
+            return;
+        }
+        worldTransformDirty_ = true;
+        for (auto& child : children_) {
+            child->markWorldTransformDirty();
+        }
+    }
+
+    // Dirty nodes always have dirty ancestors, so the walk can stop at the first one already marked
+    void markBoundsDirty() {
+        for (SceneNode* node = this; node != nullptr && !node->boundsDirty_; node = node->parent_) {
+            node->boundsDirty_ = true;
+        }
+    }
+
+private:
+    void updateChildren(const sf::Time& dt) {
+        constexpr std::size_t parallelGrain = 256;
+        if (jobs_ && children_.size() > parallelGrain) {
+            // Each chunk updates whole child subtrees, parents before their children.
+            // Dirtying this node's bounds and resolving its world transform up front
+            // means no child ever writes above itself while the chunks run.
+            markBoundsDirty();
+            getWorldTransform();
+            jobs_->parallelFor(children_.size(), parallelGrain, [this, &dt](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    children_[i]->update(dt);
+                }
+                });
+            return;
+        }
+
+        for (auto& child : children_) {
+            child->update(dt);
+        }
+    }
+
+    virtual void updateCurrent(const sf::Time&) {}
+
+    void attachIndex(CategoryIndex* index) {
+        index_ = index;
+        index_->add(this, getCategory(), indexSlots_);
+        for (auto& child : children_) {
+            child->attachIndex(index);
+        }
+    }
+
+    void detachIndex() {
+        index_->remove(this, getCategory(), indexSlots_);
+        index_ = nullptr;
+        for (auto& child : children_) {
+            child->detachIndex();
+        }
+    }
+
+    virtual void drawCurrent(sf::RenderTarget&, sf::RenderStates) const {}
+
+    // Only nodes that override this show up in the batched path
+    virtual void batchCurrent(RenderQueue&, const sf::Transform&, unsigned int) const {}
+
+    sf::Transform getInterpolatedTransform(float alpha) const {
+        sf::Transform blended;
+        blended.translate((previousPosition_ - getPosition()) * (1.f - alpha));
+        return blended * getTransform();
+    }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const final override {
+        render(target, states, 1.f);
+    }
+
+    SceneNode* parent_;
+    CategoryIndex* index_;
+    CategoryIndex::Slots indexSlots_{};
+    JobSystem* jobs_;
+    std::vector<Ptr> children_;
+    sf::Vector2f previousPosition_;
+    std::optional<unsigned int> renderLayer_;
+    mutable sf::FloatRect subtreeBounds_;
+    mutable bool boundsDirty_;
+    mutable sf::Transform worldTransform_;
+    mutable bool worldTransformDirty_;
+    bool removalPending_;
+    bool wrecksBelow_;
+    bool stableOrder_;
+};
+
+using TextureHolder = ResourceManager<sf::Texture, Textures::ID>;
+using SoundBufferHolder = ResourceManager<sf::SoundBuffer, SoundEffects::ID>;
+
+// Lightweight handle to a sub-rectangle of an atlas page
+struct TextureRegion {
+    const sf::Texture* texture_ = nullptr;
+    sf::IntRect rect_;
+};
+
+// Shelf-packs small sprite images into a few shared pages so sprites drawn
+// together don't switch textures. Pages grow in height as they fill up and
+// are only sent to the GPU in upload(); regions stay valid for the atlas lifetime.
+class TextureAtlas {
+public:
+    explicit TextureAtlas(unsigned int pageSize = 1024, unsigned int padding = 1)
+        : pageSize_(pageSize), padding_(padding) {
+    }
+
+    const TextureRegion& load(Textures::ID id) {
+        if (contains(id)) {
+            return regions_[id];
+        }
+
+        const std::filesystem::path path(Assets::getPath(id));
+        const std::span<const std::byte> packed = AssetPack::instance().find(id);
+        sf::Image image;
+        if (packed.empty() ? !image.loadFromFile(path) : !image.loadFromMemory(packed.data(), packed.size())) {
+            throw std::runtime_error("Can't load resource from file: " + path.string());
+        }
+        return add(id, image);
+    }
+
+    const TextureRegion& add(Textures::ID id, const sf::Image& image) {
+        if (contains(id)) {
+            return regions_[id];
+        }
+
+        const sf::Vector2u size = image.getSize();
+        Page& page = findPage(size);
+
+        if (page.cursorX_ + size.x > page.width_) {
+            page.shelfY_ += page.shelfHeight_ + padding_;
+            page.cursorX_ = 0;
+            page.shelfHeight_ = 0;
+        }
+
+        const sf::Vector2u position(page.cursorX_, page.shelfY_);
+        growPage(page, position.y + size.y);
+        if (!page.image_.copy(image, position)) {
+            throw std::runtime_error("Can't pack into texture atlas: " + std::string(Assets::getPath(id)));
+        }
+
+        page.cursorX_ += size.x + padding_;
+        page.shelfHeight_ = std::max(page.shelfHeight_, size.y);
+        page.dirty_ = true;
+
+        TextureRegion& region = regions_[id];
+        region.texture_ = page.texture_.get();
+        region.rect_ = sf::IntRect(sf::Vector2i(position), sf::Vector2i(size));
+        return region;
+    }
+
+    // Main thread only: re-uploads pages that received new images
+    void upload() {
+        for (auto& page : pages_) {
+            if (!page.dirty_) {
+                continue;
+            }
+            if (!page.texture_->loadFromImage(page.image_)) {
+                throw std::runtime_error("Can't upload texture atlas page");
+            }
+            page.dirty_ = false;
+        }
+    }
+
+    const TextureRegion& get(Textures::ID id) const {
+        assert(contains(id) && "Atlas region not found.");
+        return regions_[id];
+    }
+
+    bool contains(Textures::ID id) const {
+        return regions_[id].texture_ != nullptr;
+    }
+
+    std::size_t getPageCount() const {
+        return pages_.size();
+    }
+
+private:
+    struct Page {
+        unsigned int width_ = 0;
+        unsigned int maxHeight_ = 0;
+        unsigned int cursorX_ = 0;
+        unsigned int shelfY_ = 0;
+        unsigned int shelfHeight_ = 0;
+        bool dirty_ = false;
+        sf::Image image_;
+        std::unique_ptr<sf::Texture> texture_ = std::make_unique<sf::Texture>();
+    };
+
+    bool fits(const Page& page, sf::Vector2u size) const {
+        if (size.x > page.width_) {
+            return false;
+        }
+        unsigned int y = page.shelfY_;
+        if (page.cursorX_ + size.x > page.width_) {
+            y += page.shelfHeight_ + padding_;
+        }
+        return y + size.y <= page.maxHeight_;
+    }
+
+    Page& findPage(sf::Vector2u size) {
+        for (auto& page : pages_) {
+            if (fits(page, size)) {
+                return page;
+            }
+        }
+
+        // Images bigger than a page get a page of their own
+        Page& page = pages_.emplace_back();
+        page.width_ = std::max(pageSize_, size.x);
+        page.maxHeight_ = std::max(pageSize_, size.y);
+        return page;
+    }
+
+    void growPage(Page& page, unsigned int height) {
+        if (height <= page.image_.getSize().y) {
+            return;
+        }
+
+        sf::Image grown({ page.width_, std::min(std::bit_ceil(height), page.maxHeight_) }, sf::Color::Transparent);
+        if (page.image_.getSize().y > 0 && !grown.copy(page.image_, { 0u, 0u })) {
+            throw std::runtime_error("Can't grow texture atlas page");
+        }
+        page.image_ = std::move(grown);
+    }
+
+    unsigned int pageSize_;
+    unsigned int padding_;
+    std::vector<Page> pages_;
+    std::array<TextureRegion, Textures::Count> regions_{};
+};
+
+template <typename T, typename... Args>
+std::unique_ptr<T, NodeDeleter> makeNode(std::pmr::memory_resource* resource, Args&&... args) {
+    if (!resource) {
+        return std::unique_ptr<T, NodeDeleter>(new T(std::forward<Args>(args)...));
+    }
+
+    void* memory = resource->allocate(sizeof(T), alignof(T));
+    try {
+        T* node = ::new (memory) T(std::forward<Args>(args)...);
+        return std::unique_ptr<T, NodeDeleter>(node, NodeDeleter{ resource, sizeof(T), alignof(T) });
+    }
+    catch (...) {
+        resource->deallocate(memory, sizeof(T), alignof(T));
+        throw;
+    }
+}
+
+// Owns the memory for a scene's nodes. Size-segregated free lists sit on top of
+// a monotonic arena, so spawning and despawning recycle blocks without touching
+// the global allocator once warmed up, and same-type nodes stay close together.
+// Must outlive every node it made.
+class NodePool {
+public:
+    explicit NodePool(std::size_t initialArenaBytes = 64 * 1024)
+        : arena_(initialArenaBytes), pool_(&arena_) {
+    }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    template <typename T, typename... Args>
+    std::unique_ptr<T, NodeDeleter> make(Args&&... args) {
+        AllocationScope allocations(AllocationCounter::SceneNodes);
+        return makeNode<T>(&pool_, std::forward<Args>(args)...);
+    }
+
+private:
+    std::pmr::monotonic_buffer_resource arena_;
+    std::pmr::unsynchronized_pool_resource pool_;
+};
+
+class SpriteNode : public SceneNode {
+public:
+    explicit SpriteNode(const sf::Texture& texture)
+        : sprite_(texture) {
+    }
+
+    SpriteNode(const sf::Texture& texture, const sf::IntRect& rect)
+        : sprite_(texture, rect) {
+    }
+
+    explicit SpriteNode(const TextureRegion& region)
+        : sprite_(*region.texture_, region.rect_) {
+    }
+
+private:
+    sf::FloatRect getDrawBounds() const override {
+        return sprite_.getGlobalBounds();
+    }
+
+    void drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const override {
+        target.draw(sprite_, states);
+    }
+
+    void batchCurrent(RenderQueue& queue, const sf::Transform& transform, unsigned int layer) const override {
+        queue.push(layer, sprite_.getTexture(), transform * sprite_.getTransform(), sprite_.getTextureRect(), sprite_.getColor());
+    }
+
+    sf::Sprite sprite_;
+};
+
+// Background made of tiles laid out on a grid around the camera. stream() keeps
+// just the tiles within a one-tile margin of the view resident: new ones come in
+// ahead of the camera, old ones are dropped behind it. Cost is set by the screen
+// size, not the level length, and each tile's texture rect stays small however
+// far the level scrolls. With parallax below 1 the layer lags behind the camera
+// (0 pins it to the screen), so several can be stacked for depth.
+class TiledBackground : public SceneNode {
+public:
+    // Asked once per tile as it streams in
+    using TileSource = InlineFunction<TextureRegion(sf::Vector2i)>;
+
+    TiledBackground(sf::Vector2f tileSize, TileSource source, float parallax = 1.f)
+        : tileSize_(tileSize), source_(std::move(source)), parallax_(parallax) {
+        assert(tileSize.x > 0.f && tileSize.y > 0.f && "Tiles need a size");
+    }
+
+    // Call once per tick with the camera's visible rect, in world space
+    void stream(const sf::FloatRect& view) {
+        // The layer is offset so it moves parallax_ times as far as the camera
+        const sf::Vector2f offset = view.position * (1.f - parallax_);
+        if (offset != getPosition()) {
+            setPosition(offset);
+        }
+
+        const sf::Vector2f local = view.position - offset;
+        const sf::Vector2i first(
+            static_cast<int>(std::floor(local.x / tileSize_.x)) - margin_,
+            static_cast<int>(std::floor(local.y / tileSize_.y)) - margin_);
+        const sf::Vector2i last(
+            static_cast<int>(std::floor((local.x + view.size.x) / tileSize_.x)) + margin_,
+            static_cast<int>(std::floor((local.y + view.size.y) / tileSize_.y)) + margin_);
+        if (!tiles_.empty() && first == first_ && last == last_) {
+            return;
+        }
+
+        // Keep tiles still in range, ask the source for the ones that just came in
+        streamed_.clear();
+        for (int y = first.y; y <= last.y; ++y) {
+            for (int x = first.x; x <= last.x; ++x) {
+                const sf::Vector2i cell(x, y);
+                if (!tiles_.empty() && x >= first_.x && x <= last_.x && y >= first_.y && y <= last_.y) {
+                    streamed_.push_back(tiles_[static_cast<std::size_t>((y - first_.y) * (last_.x - first_.x + 1) + (x - first_.x))]);
+                }
+                else {
+                    streamed_.push_back({ cell, source_(cell) });
+                }
+            }
+        }
+        tiles_.swap(streamed_);
+        first_ = first;
+        last_ = last;
+        markBoundsDirty();
+    }
+
+    std::size_t getTileCount() const {
+        return tiles_.size();
+    }
+
+private:
+    struct Tile {
+        sf::Vector2i cell_;
+        TextureRegion region_;
+    };
+
+    static constexpr int margin_ = 1;
+
+    sf::Transform getTileTransform(const Tile& tile) const {
+        sf::Transform transform;
+        transform.translate({ static_cast<float>(tile.cell_.x) * tileSize_.x, static_cast<float>(tile.cell_.y) * tileSize_.y });
+        if (tile.region_.rect_.size.x != 0 && tile.region_.rect_.size.y != 0) {
+            transform.scale({ tileSize_.x / static_cast<float>(tile.region_.rect_.size.x),
+                tileSize_.y / static_cast<float>(tile.region_.rect_.size.y) });
+        }
+        return transform;
+    }
+
+    sf::FloatRect getDrawBounds() const override {
+        if (tiles_.empty()) {
+            return {};
+        }
+        return sf::FloatRect(
+            { static_cast<float>(first_.x) * tileSize_.x, static_cast<float>(first_.y) * tileSize_.y },
+            { static_cast<float>(last_.x - first_.x + 1) * tileSize_.x, static_cast<float>(last_.y - first_.y + 1) * tileSize_.y });
+    }
+
+    void drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const override {
+        const sf::Transform transform = states.transform;
+        for (const Tile& tile : tiles_) {
+            states.transform = transform * getTileTransform(tile);
+            target.draw(sf::Sprite(*tile.region_.texture_, tile.region_.rect_), states);
+        }
+    }
+
+    void batchCurrent(RenderQueue& queue, const sf::Transform& transform, unsigned int layer) const override {
+        for (const Tile& tile : tiles_) {
+            queue.push(layer, *tile.region_.texture_, transform * getTileTransform(tile), tile.region_.rect_);
+        }
+    }
+
+    sf::Vector2f tileSize_;
+    TileSource source_;
+    float parallax_;
+    sf::Vector2i first_;
+    sf::Vector2i last_;
+    std::vector<Tile> tiles_;
+    std::vector<Tile> streamed_;
+};
+
+class Entity : public SceneNode {
+public:
+    void setVelocity(const sf::Vector2f& velocity) {
+        velocity_ = velocity;
+    }
+
+    void setVelocity(float dx, float dy) {
+        velocity_ = sf::Vector2f(dx, dy);
+    }
+
+    void accelerate(float x, float y) {
+        sf::Vector2f newVelocity(x, y);
+        setVelocity(getVelocity() + newVelocity);
+    }
+
+    const sf::Vector2f& getVelocity() const {
+        return velocity_;
+    }
+
+protected:
+    // A move, even by zero, marks the transform dirty; resting entities keep their cached one
+    void updateCurrent(const sf::Time& dt) override {
+        if (velocity_ != sf::Vector2f()) {
+            move(velocity_ * dt.asSeconds());
+        }
+    }
+
+private:
+    sf::Vector2f velocity_;
+};
+
+class Aircraft : public Entity {
+public:
+    enum Type {
+        Eagle,
+        Raptor
+    };
+
+    Aircraft(Type type, const TextureRegion& region, bool hostile = false)
+        : sprite_(*region.texture_, region.rect_), type_(type), hostile_(hostile) {
+    }
+
+    unsigned int getCategory() const override {
+        if (hostile_) {
+            return Category::EnemyAircraft;
+        }
+        // Only the main Eagle responds to player commands
+        if (type_ == Eagle) {
+            return Category::PlayerAircraft;
+        }
+        return Category::AlliedAircraft; // Escort aircraft don't respond to player input
+    }
+
+    Type getAircraftType() const {
+        return type_;
+    }
+
+    // Set by the Fire command every tick it is held; launch() turns it into shots at the fire rate
+    void fire() {
+        firing_ = true;
+    }
+
+    bool launch() {
+        const bool launched = firing_ && fireCountdown_ <= sf::Time::Zero;
+        if (launched) {
+            fireCountdown_ = fireInterval_;
+        }
+        firing_ = false;
+        return launched;
+    }
+
+    sf::FloatRect getBoundingRect() const override {
+        return getWorldTransform().transformRect(sprite_.getGlobalBounds());
+    }
+
+protected:
+    void updateCurrent(const sf::Time& dt) override {
+        Entity::updateCurrent(dt);
+        fireCountdown_ = std::max(fireCountdown_ - dt, sf::Time::Zero);
+    }
+
+private:
+    sf::FloatRect getDrawBounds() const override {
+        return sprite_.getGlobalBounds();
+    }
+
+    void drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const override {
+        target.draw(sprite_, states);
+    }
+
+    void batchCurrent(RenderQueue& queue, const sf::Transform& transform, unsigned int layer) const override {
+        queue.push(layer, sprite_.getTexture(), transform * sprite_.getTransform(), sprite_.getTextureRect(), sprite_.getColor());
+    }
+
+    static constexpr sf::Time fireInterval_ = sf::milliseconds(100);
+
+    sf::Sprite sprite_;
+    Type type_;
+    bool hostile_;
+    bool firing_ = false;
+    sf::Time fireCountdown_ = sf::Time::Zero;
+};
+
+// Enemy spawns for a level, sorted by world Y. consume() walks outwards from
+// the camera in both directions, so each spawn is handed out exactly once, as
+// the spawn window first reaches its Y, and nothing is built ahead of time.
+// Level lines are "<Aircraft type> <x> <y> [<vx> <vy>]"; '#' starts a comment.
+class SpawnSchedule {
+public:
+    struct Spawn {
+        Aircraft::Type type_;
+        sf::Vector2f position_;
+        sf::Vector2f velocity_;
+    };
+
+    void load(Levels::ID id) {
+        const std::filesystem::path path(Assets::getPath(id));
+        const std::span<const std::byte> packed = AssetPack::instance().find(id);
+        if (!packed.empty()) {
+            std::istringstream stream(std::string(reinterpret_cast<const char*>(packed.data()), packed.size()));
+            parse(stream, path.string());
+            return;
+        }
+
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Can't open level: " + path.string());
+        }
+        parse(file, path.string());
+    }
+
+    void parse(std::istream& stream, const std::string& name) {
+        spawns_.clear();
+        std::string line;
+        while (std::getline(stream, line)) {
+            line.erase(std::ranges::find(line, '#'), line.end());
+            std::istringstream fields(line);
+            std::string type;
+            if (!(fields >> type)) {
+                continue;
+            }
+            Spawn spawn{ toType(type), {}, {} };
+            if (!(fields >> spawn.position_.x >> spawn.position_.y)) {
+                throw std::runtime_error("Missing position for " + type + " in " + name);
+            }
+            fields >> spawn.velocity_.x >> spawn.velocity_.y;
+            spawns_.push_back(spawn);
+        }
+
+        std::ranges::stable_sort(spawns_, std::less{}, [](const Spawn& spawn) { return spawn.position_.y; });
+        above_ = below_ = 0;
+        started_ = false;
+    }
+
+    // Hands every spawn whose Y has entered [top, bottom] to fn, once
+    template <typename Fn>
+    void consume(float top, float bottom, Fn&& fn) {
+        if (!started_) {
+            above_ = below_ = static_cast<std::size_t>(std::ranges::lower_bound(spawns_, top, std::less{},
+                [](const Spawn& spawn) { return spawn.position_.y; }) - spawns_.begin());
+            started_ = true;
+        }
+        while (above_ > 0 && spawns_[above_ - 1].position_.y >= top) {
+            fn(spawns_[--above_]);
+        }
+        while (below_ < spawns_.size() && spawns_[below_].position_.y <= bottom) {
+            fn(spawns_[below_++]);
+        }
+    }
+
+    std::size_t getRemaining() const {
+        return spawns_.size() - (below_ - above_);
+    }
+
+private:
+    static Aircraft::Type toType(const std::string& id) {
+        if (id == "Eagle") return Aircraft::Eagle;
+        if (id == "Raptor") return Aircraft::Raptor;
+        throw std::runtime_error("Unknown aircraft type: " + id);
+    }
+
+    std::vector<Spawn> spawns_;
+    std::size_t above_ = 0;
+    std::size_t below_ = 0;
+    bool started_ = false;
+};
+
+// Batch integrate/clamp/cull kernel over structure-of-arrays coordinates.
+// AVX2 handles 8 entities per instruction, SSE2 and NEON 4, the scalar loop the rest.
+namespace Kinematics {
+    // The vector path step() was compiled with
+#if defined(__AVX2__)
+    inline constexpr std::string_view simdPath = "AVX2";
+#elif defined(SPACESHOOTER_SSE2)
+    inline constexpr std::string_view simdPath = "SSE2";
+#elif defined(__ARM_NEON)
+    inline constexpr std::string_view simdPath = "NEON";
+#else
+    inline constexpr std::string_view simdPath = "scalar";
+#endif
+
+    // Advances every entity by its velocity, clamps it into clampBounds (if any) and
+    // sets outside[i] when it ends up beyond cullBounds. Returns how many are outside.
+    inline std::size_t step(float* x, float* y, const float* vx, const float* vy, std::uint8_t* outside,
+        std::size_t count, float dt, const sf::FloatRect* clampBounds, const sf::FloatRect& cullBounds) {
+        constexpr float infinity = std::numeric_limits<float>::infinity();
+        const float minX = clampBounds ? clampBounds->position.x : -infinity;
+        const float minY = clampBounds ? clampBounds->position.y : -infinity;
+        const float maxX = clampBounds ? clampBounds->position.x + clampBounds->size.x : infinity;
+        const float maxY = clampBounds ? clampBounds->position.y + clampBounds->size.y : infinity;
+        const float left = cullBounds.position.x;
+        const float top = cullBounds.position.y;
+        const float right = cullBounds.position.x + cullBounds.size.x;
+        const float bottom = cullBounds.position.y + cullBounds.size.y;
+
+        std::size_t i = 0;
+        std::size_t leaving = 0;
+
+#if defined(__AVX2__)
+        const __m256 vdt = _mm256_set1_ps(dt);
+        const __m256 vMinX = _mm256_set1_ps(minX), vMaxX = _mm256_set1_ps(maxX);
+        const __m256 vMinY = _mm256_set1_ps(minY), vMaxY = _mm256_set1_ps(maxY);
+        const __m256 vLeft = _mm256_set1_ps(left), vRight = _mm256_set1_ps(right);
+        const __m256 vTop = _mm256_set1_ps(top), vBottom = _mm256_set1_ps(bottom);
+        for (; i + 8 <= count; i += 8) {
+            __m256 px = _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), vdt));
+            __m256 py = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(vy + i), vdt));
+            px = _mm256_min_ps(_mm256_max_ps(px, vMinX), vMaxX);
+            py = _mm256_min_ps(_mm256_max_ps(py, vMinY), vMaxY);
+            _mm256_storeu_ps(x + i, px);
+            _mm256_storeu_ps(y + i, py);
+
+            const __m256 out = _mm256_or_ps(
+                _mm256_or_ps(_mm256_cmp_ps(px, vLeft, _CMP_LT_OQ), _mm256_cmp_ps(px, vRight, _CMP_GT_OQ)),
+                _mm256_or_ps(_mm256_cmp_ps(py, vTop, _CMP_LT_OQ), _mm256_cmp_ps(py, vBottom, _CMP_GT_OQ)));
+            const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_ps(out));
+            for (std::size_t lane = 0; lane < 8; ++lane) {
+                outside[i + lane] = static_cast<std::uint8_t>((mask >> lane) & 1u);
+            }
+            leaving += static_cast<std::size_t>(std::popcount(mask));
+        }
+#elif defined(SPACESHOOTER_SSE2)
+        const __m128 vdt = _mm_set1_ps(dt);
+        const __m128 vMinX = _mm_set1_ps(minX), vMaxX = _mm_set1_ps(maxX);
+        const __m128 vMinY = _mm_set1_ps(minY), vMaxY = _mm_set1_ps(maxY);
+        const __m128 vLeft = _mm_set1_ps(left), vRight = _mm_set1_ps(right);
+        const __m128 vTop = _mm_set1_ps(top), vBottom = _mm_set1_ps(bottom);
+        for (; i + 4 <= count; i += 4) {
+            __m128 px = _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), vdt));
+            __m128 py = _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(vy + i), vdt));
+            px = _mm_min_ps(_mm_max_ps(px, vMinX), vMaxX);
+            py = _mm_min_ps(_mm_max_ps(py, vMinY), vMaxY);
+            _mm_storeu_ps(x + i, px);
+            _mm_storeu_ps(y + i, py);
+
+            const __m128 out = _mm_or_ps(
+                _mm_or_ps(_mm_cmplt_ps(px, vLeft), _mm_cmpgt_ps(px, vRight)),
+                _mm_or_ps(_mm_cmplt_ps(py, vTop), _mm_cmpgt_ps(py, vBottom)));
+            const unsigned int mask = static_cast<unsigned int>(_mm_movemask_ps(out));
+            for (std::size_t lane = 0; lane < 4; ++lane) {
+                outside[i + lane] = static_cast<std::uint8_t>((mask >> lane) & 1u);
+            }
+            leaving += static_cast<std::size_t>(std::popcount(mask));
+        }
+#elif defined(__ARM_NEON)
+        const float32x4_t vMinX = vdupq_n_f32(minX), vMaxX = vdupq_n_f32(maxX);
+        const float32x4_t vMinY = vdupq_n_f32(minY), vMaxY = vdupq_n_f32(maxY);
+        const float32x4_t vLeft = vdupq_n_f32(left), vRight = vdupq_n_f32(right);
+        const float32x4_t vTop = vdupq_n_f32(top), vBottom = vdupq_n_f32(bottom);
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t px = vmlaq_n_f32(vld1q_f32(x + i), vld1q_f32(vx + i), dt);
+            float32x4_t py = vmlaq_n_f32(vld1q_f32(y + i), vld1q_f32(vy + i), dt);
+            px = vminq_f32(vmaxq_f32(px, vMinX), vMaxX);
+            py = vminq_f32(vmaxq_f32(py, vMinY), vMaxY);
+            vst1q_f32(x + i, px);
+            vst1q_f32(y + i, py);
+
+            const uint32x4_t out = vorrq_u32(
+                vorrq_u32(vcltq_f32(px, vLeft), vcgtq_f32(px, vRight)),
+                vorrq_u32(vcltq_f32(py, vTop), vcgtq_f32(py, vBottom)));
+            std::uint32_t lanes[4];
+            vst1q_u32(lanes, out);
+            for (std::size_t lane = 0; lane < 4; ++lane) {
+                outside[i + lane] = static_cast<std::uint8_t>(lanes[lane] & 1u);
+                leaving += lanes[lane] & 1u;
+            }
+        }
+#endif
+
+        for (; i < count; ++i) {
+            x[i] = std::min(std::max(x[i] + vx[i] * dt, minX), maxX);
+            y[i] = std::min(std::max(y[i] + vy[i] * dt, minY), maxY);
+            const bool out = x[i] < left || x[i] > right || y[i] < top || y[i] > bottom;
+            outside[i] = static_cast<std::uint8_t>(out);
+            leaving += out;
+        }
+        return leaving;
+    }
+}
+
+// Generational handle into an EntityStore; stale handles are detected, not reused
+struct EntityHandle {
+    std::uint32_t index_ = std::numeric_limits<std::uint32_t>::max();
+    std::uint32_t generation_ = 0;
+};
+
+// Structure-of-arrays storage for flat, high-count entities (bullets, enemies).
+// Components live in dense parallel arrays integrated by the Kinematics kernel;
+// removal is swap-and-pop, with a sparse slot table keeping handles stable. An
+// entity may be bound to a SceneNode, whose position is written back after
+// integration; unbound entities are drawn straight from the arrays.
+class EntityStore {
+public:
+    EntityHandle create(sf::Vector2f position, sf::Vector2f velocity, unsigned int category,
+        const TextureRegion& sprite, SceneNode* node = nullptr) {
+        std::uint32_t slot;
+        if (!freeSlots_.empty()) {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+        else {
+            slot = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back({});
+        }
+
+        slots_[slot].dense_ = static_cast<std::uint32_t>(x_.size());
+        x_.push_back(position.x);
+        y_.push_back(position.y);
+        previousX_.push_back(position.x);
+        previousY_.push_back(position.y);
+        vx_.push_back(velocity.x);
+        vy_.push_back(velocity.y);
+        outside_.push_back(0);
+        categories_.push_back(category);
+        sprites_.push_back(sprite);
+        nodes_.push_back(node);
+        owners_.push_back(slot);
+        return { slot, slots_[slot].generation_ };
+    }
+
+    void destroy(EntityHandle handle) {
+        assert(contains(handle) && "Stale entity handle");
+        destroyDense(slots_[handle.index_].dense_);
+    }
+
+    bool contains(EntityHandle handle) const {
+        return handle.index_ < slots_.size() && slots_[handle.index_].generation_ == handle.generation_;
+    }
+
+    // Moves every entity, optionally clamping it into clampBounds, and flags the ones beyond cullBounds
+    std::size_t integrate(sf::Time dt, const sf::FloatRect& cullBounds, const sf::FloatRect* clampBounds = nullptr) {
+        previousX_ = x_;
+        previousY_ = y_;
+        return Kinematics::step(x_.data(), y_.data(), vx_.data(), vy_.data(), outside_.data(),
+            x_.size(), dt.asSeconds(), clampBounds, cullBounds);
+    }
+
+    // Removes everything the last integrate() flagged as outside its cull bounds
+    std::size_t destroyOutside() {
+        std::size_t removed = 0;
+        for (std::size_t i = x_.size(); i-- > 0;) {
+            if (outside_[i]) {
+                destroyDense(static_cast<std::uint32_t>(i));
+                ++removed;
+            }
+        }
+        return removed;
+    }
+
+    // Write positions back only for entities that are mirrored by a scene node
+    void syncNodes() const {
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            if (nodes_[i]) {
+                nodes_[i]->setPosition({ x_[i], y_[i] });
+            }
+        }
+    }
+
+    // Bound nodes are drawn by the scene graph, so only unbound entities are submitted here
+    void submit(RenderQueue& queue, unsigned int layer, float alpha) const {
+        for (std::size_t i = 0; i < x_.size(); ++i) {
+            if (nodes_[i]) {
+                continue;
+            }
+            const sf::Vector2f position(previousX_[i] + (x_[i] - previousX_[i]) * alpha,
+                previousY_[i] + (y_[i] - previousY_[i]) * alpha);
+            if (queue.isCulled({ position, sf::Vector2f(sprites_[i].rect_.size) })) {
+                continue;
+            }
+            sf::Transform transform;
+            transform.translate(position);
+            queue.push(layer, *sprites_[i].texture_, transform, sprites_[i].rect_);
+        }
+    }
+
+    sf::Vector2f getPosition(EntityHandle handle) const {
+        const std::uint32_t i = dense(handle);
+        return { x_[i], y_[i] };
+    }
+
+    void setPosition(EntityHandle handle, sf::Vector2f position) {
+        const std::uint32_t i = dense(handle);
+        x_[i] = position.x;
+        y_[i] = position.y;
+    }
+
+    sf::Vector2f getVelocity(EntityHandle handle) const {
+        const std::uint32_t i = dense(handle);
+        return { vx_[i], vy_[i] };
+    }
+
+    void setVelocity(EntityHandle handle, sf::Vector2f velocity) {
+        const std::uint32_t i = dense(handle);
+        vx_[i] = velocity.x;
+        vy_[i] = velocity.y;
+    }
+
+    unsigned int getCategory(EntityHandle handle) const {
+        return categories_[dense(handle)];
+    }
+
+    std::size_t size() const {
+        return x_.size();
+    }
+
+    // Destroys everything; outstanding handles become stale rather than dangling
+    void clear() {
+        while (!x_.empty()) {
+            destroyDense(static_cast<std::uint32_t>(x_.size() - 1));
+        }
+    }
+
+    void reserve(std::size_t count) {
+        for (auto* column : { &x_, &y_, &previousX_, &previousY_, &vx_, &vy_ }) {
+            column->reserve(count);
+        }
+        outside_.reserve(count);
+        categories_.reserve(count);
+        sprites_.reserve(count);
+        nodes_.reserve(count);
+        owners_.reserve(count);
+        slots_.reserve(count);
+    }
+
+private:
+    struct Slot {
+        std::uint32_t dense_ = 0;
+        std::uint32_t generation_ = 0;
+    };
+
+    std::uint32_t dense(EntityHandle handle) const {
+        assert(contains(handle) && "Stale entity handle");
+        return slots_[handle.index_].dense_;
+    }
+
+    void destroyDense(std::uint32_t dense) {
+        const std::uint32_t slot = owners_[dense];
+        const std::size_t last = x_.size() - 1;
+
+        if (dense != last) {
+            x_[dense] = x_[last];
+            y_[dense] = y_[last];
+            previousX_[dense] = previousX_[last];
+            previousY_[dense] = previousY_[last];
+            vx_[dense] = vx_[last];
+            vy_[dense] = vy_[last];
+            outside_[dense] = outside_[last];
+            categories_[dense] = categories_[last];
+            sprites_[dense] = sprites_[last];
+            nodes_[dense] = nodes_[last];
+            owners_[dense] = owners_[last];
+            slots_[owners_[dense]].dense_ = dense;
+        }
+
+        x_.pop_back();
+        y_.pop_back();
+        previousX_.pop_back();
+        previousY_.pop_back();
+        vx_.pop_back();
+        vy_.pop_back();
+        outside_.pop_back();
+        categories_.pop_back();
+        sprites_.pop_back();
+        nodes_.pop_back();
+        owners_.pop_back();
+
+        ++slots_[slot].generation_;
+        freeSlots_.push_back(slot);
+    }
+
+    std::vector<float> x_;
+    std::vector<float> y_;
+    std::vector<float> previousX_;
+    std::vector<float> previousY_;
+    std::vector<float> vx_;
+    std::vector<float> vy_;
+    std::vector<std::uint8_t> outside_;
+    std::vector<unsigned int> categories_;
+    std::vector<TextureRegion> sprites_;
+    std::vector<SceneNode*> nodes_;
+    std::vector<std::uint32_t> owners_;
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> freeSlots_;
+};
+
+// Uniform-grid broad phase. Items are keyed by Key and updated in place each
+// tick: an item only touches the grid when the cells it covers change, and
+// items not refreshed between beginUpdate() and endUpdate() are dropped.
+// Category masks prune candidates before the bounds overlap test.
+template <typename Key>
+class SpatialGrid {
+public:
+    SpatialGrid(const sf::FloatRect& bounds, float cellSize)
+        : origin_(bounds.position),
+        cellSize_(cellSize),
+        columns_(std::max(1, static_cast<int>(std::ceil(bounds.size.x / cellSize)))),
+        rows_(std::max(1, static_cast<int>(std::ceil(bounds.size.y / cellSize)))),
+        cells_(static_cast<std::size_t>(columns_ * rows_)),
+        tick_(0),
+        queryStamp_(0) {
+    }
+
+    void beginUpdate() {
+        ++tick_;
+    }
+
+    void update(Key key, const sf::FloatRect& bounds, unsigned int category) {
+        auto [it, inserted] = lookup_.try_emplace(key, 0);
+        if (inserted) {
+            it->second = allocateItem();
+            Item& item = items_[it->second];
+            item.key_ = key;
+            item.cells_ = cellRange(bounds);
+            forEachCell(item.cells_, [&](std::vector<std::uint32_t>& cell) {
+                cell.push_back(it->second);
+                });
+        }
+
+        const std::uint32_t id = it->second;
+        Item& item = items_[id];
+        item.bounds_ = bounds;
+        item.category_ = category;
+        item.tick_ = tick_;
+
+        const CellRange cells = cellRange(bounds);
+        if (cells != item.cells_) {
+            removeFromCells(id);
+            item.cells_ = cells;
+            forEachCell(item.cells_, [&](std::vector<std::uint32_t>& cell) {
+                cell.push_back(id);
+                });
+        }
+    }
+
+    void endUpdate() {
+        for (std::uint32_t id = 0; id < items_.size(); ++id) {
+            Item& item = items_[id];
+            if (item.alive_ && item.tick_ != tick_) {
+                removeFromCells(id);
+                lookup_.erase(item.key_);
+                item.alive_ = false;
+                freeItems_.push_back(id);
+            }
+        }
+    }
+
+    // Calls fn(key) once for every item in categoryMask whose bounds overlap area
+    template <typename Fn>
+    void query(const sf::FloatRect& area, unsigned int categoryMask, Fn&& fn) const {
+        ++queryStamp_;
+        forEachCell(cellRange(area), [&](const std::vector<std::uint32_t>& cell) {
+            for (std::uint32_t id : cell) {
+                const Item& item = items_[id];
+                if (!(item.category_ & categoryMask) || item.queryStamp_ == queryStamp_) {
+                    continue;
+                }
+                item.queryStamp_ = queryStamp_;
+                if (item.bounds_.findIntersection(area)) {
+                    fn(item.key_);
+                }
+            }
+            });
+    }
+
+    // Calls fn(a, b) once for every overlapping pair with a in categoryA and b in categoryB
+    template <typename Fn>
+    void forEachPair(unsigned int categoryA, unsigned int categoryB, Fn&& fn) const {
+        for (std::uint32_t idA = 0; idA < items_.size(); ++idA) {
+            const Item& a = items_[idA];
+            if (!a.alive_ || !(a.category_ & categoryA)) {
+                continue;
+            }
+            ++queryStamp_;
+            forEachCell(a.cells_, [&](const std::vector<std::uint32_t>& cell) {
+                for (std::uint32_t idB : cell) {
+                    const Item& b = items_[idB];
+                    if (idB == idA || !(b.category_ & categoryB) || b.queryStamp_ == queryStamp_) {
+                        continue;
+                    }
+                    b.queryStamp_ = queryStamp_;
+                    // Pairs that match both ways are reported from the lower id only
+                    if ((b.category_ & categoryA) && (a.category_ & categoryB) && idB < idA) {
+                        continue;
+                    }
+                    if (a.bounds_.findIntersection(b.bounds_)) {
+                        fn(a.key_, b.key_);
+                    }
+                }
+                });
+        }
+    }
+
+    std::size_t size() const {
+        return lookup_.size();
+    }
+
+private:
+    struct CellRange {
+        int left_ = 0;
+        int top_ = 0;
+        int right_ = -1;
+        int bottom_ = -1;
+
+        bool operator==(const CellRange&) const = default;
+    };
+
+    struct Item {
+        Key key_{};
+        sf::FloatRect bounds_;
+        unsigned int category_ = Category::None;
+        CellRange cells_;
+        std::uint64_t tick_ = 0;
+        mutable std::uint64_t queryStamp_ = 0;
+        bool alive_ = true;
+    };
+
+    CellRange cellRange(const sf::FloatRect& bounds) const {
+        const auto toCell = [this](float value, float origin, int count) {
+            return std::clamp(static_cast<int>(std::floor((value - origin) / cellSize_)), 0, count - 1);
+        };
+        return {
+            toCell(bounds.position.x, origin_.x, columns_),
+            toCell(bounds.position.y, origin_.y, rows_),
+            toCell(bounds.position.x + bounds.size.x, origin_.x, columns_),
+            toCell(bounds.position.y + bounds.size.y, origin_.y, rows_),
+        };
+    }
+
+    template <typename Fn>
+    void forEachCell(const CellRange& range, Fn&& fn) {
+        for (int y = range.top_; y <= range.bottom_; ++y) {
+            for (int x = range.left_; x <= range.right_; ++x) {
+                fn(cells_[static_cast<std::size_t>(y * columns_ + x)]);
+            }
+        }
+    }
+
+    template <typename Fn>
+    void forEachCell(const CellRange& range, Fn&& fn) const {
+        for (int y = range.top_; y <= range.bottom_; ++y) {
+            for (int x = range.left_; x <= range.right_; ++x) {
+                fn(cells_[static_cast<std::size_t>(y * columns_ + x)]);
+            }
+        }
+    }
+
+    std::uint32_t allocateItem() {
+        if (!freeItems_.empty()) {
+            const std::uint32_t id = freeItems_.back();
+            freeItems_.pop_back();
+            items_[id] = Item{};
+            return id;
+        }
+        items_.emplace_back();
+        return static_cast<std::uint32_t>(items_.size() - 1);
+    }
+
+    void removeFromCells(std::uint32_t id) {
+        forEachCell(items_[id].cells_, [id](std::vector<std::uint32_t>& cell) {
+            auto it = std::ranges::find(cell, id);
+            assert(it != cell.end() && "Item missing from grid cell");
+            *it = cell.back();
+            cell.pop_back();
+            });
+    }
+
+    sf::Vector2f origin_;
+    float cellSize_;
+    int columns_;
+    int rows_;
+    std::vector<std::vector<std::uint32_t>> cells_;
+    std::vector<Item> items_;
+    std::vector<std::uint32_t> freeItems_;
+    std::unordered_map<Key, std::uint32_t> lookup_;
+    std::uint64_t tick_;
+    mutable std::uint64_t queryStamp_;
+};
+
+// Fixed-capacity pool for bullets and effect particles: short-lived, high-count
+// points with no scene node. Columns are allocated once; live particles stay
+// packed at the front and [size, capacity) is the free list, so the update and
+// draw loops never skip holes and killing one is a swap with the last live slot.
+// Particles with a hit mask are projectiles, tested against the collision broad
+// phase; the rest are purely visual.
+class ParticleSystem {
+public:
+    explicit ParticleSystem(std::size_t capacity)
+        : x_(capacity), y_(capacity), previousX_(capacity), previousY_(capacity), vx_(capacity), vy_(capacity),
+        life_(capacity), fade_(capacity), sizes_(capacity), colors_(capacity), hitMasks_(capacity),
+        outside_(capacity), count_(0) {
+    }
+
+    // Returns false (and drops the particle) when the pool is full
+    bool emit(sf::Vector2f position, sf::Vector2f velocity, sf::Time lifetime, sf::Color color, float size,
+        unsigned int hitMask = Category::None) {
+        if (count_ == x_.size()) {
+            return false;
+        }
+        const std::size_t i = count_++;
+        x_[i] = previousX_[i] = position.x;
+        y_[i] = previousY_[i] = position.y;
+        vx_[i] = velocity.x;
+        vy_[i] = velocity.y;
+        life_[i] = lifetime.asSeconds();
+        fade_[i] = 1.f / std::max(lifetime.asSeconds(), std::numeric_limits<float>::epsilon());
+        sizes_[i] = size;
+        colors_[i] = color;
+        hitMasks_[i] = hitMask;
+        return true;
+    }
+
+    // Moves everything in one pass and kills what expired or left bounds
+    void update(sf::Time dt, const sf::FloatRect& bounds) {
+        std::copy_n(x_.begin(), count_, previousX_.begin());
+        std::copy_n(y_.begin(), count_, previousY_.begin());
+        const float seconds = dt.asSeconds();
+        Kinematics::step(x_.data(), y_.data(), vx_.data(), vy_.data(), outside_.data(), count_, seconds, nullptr, bounds);
+
+        // Backwards, so the particle swapped into a dead slot has already been visited
+        for (std::size_t i = count_; i-- > 0;) {
+            life_[i] -= seconds;
+            if (outside_[i] || life_[i] <= 0.f) {
+                kill(i);
+            }
+        }
+    }
+
+    // Calls fn(target, position) for the nodes in the grid each projectile
+    // touches until one returns true: that one took the hit and the projectile
+    // is spent. fn may emit more particles.
+    template <typename Key, typename Fn>
+    std::size_t collide(const SpatialGrid<Key>& grid, Fn&& fn) {
+        std::size_t hits = 0;
+        for (std::size_t i = count_; i-- > 0;) {
+            if (hitMasks_[i] == Category::None) {
+                continue;
+            }
+            const float half = sizes_[i] / 2.f;
+            const sf::FloatRect area({ x_[i] - half, y_[i] - half }, { sizes_[i], sizes_[i] });
+            const sf::Vector2f position(x_[i], y_[i]);
+            bool spent = false;
+            grid.query(area, hitMasks_[i], [&](Key key) {
+                spent = spent || fn(key, position);
+                });
+            if (spent) {
+                kill(i);
+                ++hits;
+            }
+        }
+        return hits;
+    }
+
+    // One untextured quad per visible particle, all in the layer's single vertex array
+    void submit(RenderQueue& queue, unsigned int layer, float alpha) const {
+        for (std::size_t i = 0; i < count_; ++i) {
+            const float half = sizes_[i] / 2.f;
+            const sf::Vector2f position(previousX_[i] + (x_[i] - previousX_[i]) * alpha - half,
+                previousY_[i] + (y_[i] - previousY_[i]) * alpha - half);
+            const sf::FloatRect rect(position, { sizes_[i], sizes_[i] });
+            if (queue.isCulled(rect)) {
+                continue;
+            }
+            sf::Color color = colors_[i];
+            color.a = static_cast<std::uint8_t>(static_cast<float>(color.a) * std::clamp(life_[i] * fade_[i], 0.f, 1.f));
+            queue.push(layer, rect, color);
+        }
+    }
+
+    std::size_t size() const {
+        return count_;
+    }
+
+    std::size_t getCapacity() const {
+        return x_.size();
+    }
+
+    void clear() {
+        count_ = 0;
+    }
+
+private:
+    void kill(std::size_t i) {
+        const std::size_t last = --count_;
+        if (i == last) {
+            return;
+        }
+        x_[i] = x_[last];
+        y_[i] = y_[last];
+        previousX_[i] = previousX_[last];
+        previousY_[i] = previousY_[last];
+        vx_[i] = vx_[last];
+        vy_[i] = vy_[last];
+        life_[i] = life_[last];
+        fade_[i] = fade_[last];
+        sizes_[i] = sizes_[last];
+        colors_[i] = colors_[last];
+        hitMasks_[i] = hitMasks_[last];
+    }
+
+    std::vector<float> x_;
+    std::vector<float> y_;
+    std::vector<float> previousX_;
+    std::vector<float> previousY_;
+    std::vector<float> vx_;
+    std::vector<float> vy_;
+    std::vector<float> life_;
+    std::vector<float> fade_;
+    std::vector<float> sizes_;
+    std::vector<sf::Color> colors_;
+    std::vector<unsigned int> hitMasks_;
+    std::vector<std::uint8_t> outside_;
+    std::size_t count_;
+};
+
+// Ring buffer preallocated up front; it only reallocates (doubling) if a frame
+// ever queues more commands than the current capacity.
+class CommandQueue {
+public:
+    explicit CommandQueue(std::size_t capacity = 256)
+        : cmd_(std::bit_ceil(std::max<std::size_t>(capacity, 1))), head_(0), size_(0) {
+    }
+
+    void emplace(Command command) {
+        if (size_ == cmd_.size()) {
+            AllocationScope allocations(AllocationCounter::Commands);
+            grow();
+        }
+        cmd_[(head_ + size_) & (cmd_.size() - 1)] = std::move(command);
+        ++size_;
+    }
+
+    bool isEmpty() const {
+        return size_ == 0;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    Command pop() {
+        assert(size_ > 0 && "Popping an empty CommandQueue");
+        Command result = std::move(cmd_[head_]);
+        head_ = (head_ + 1) & (cmd_.size() - 1);
+        --size_;
+        return result;
+    }
+
+private:
+    void grow() {
+        std::vector<Command> grown(cmd_.size() * 2);
+        for (std::size_t i = 0; i < size_; ++i) {
+            grown[i] = std::move(cmd_[(head_ + i) & (cmd_.size() - 1)]);
+        }
+        cmd_.swap(grown);
+        head_ = 0;
+    }
+
+    std::vector<Command> cmd_;
+    std::size_t head_;
+    std::size_t size_;
+};
+
+// One bit per Player::Action held during a tick
+using ActionSet = std::uint8_t;
+
+// Run-length encoded per-tick action log. Layout, little-endian:
+// "SSIR", u8 version, u16 ticks per second, u32 tick count,
+// then (u8 actions, u16 run length) pairs until tick count is reached.
+namespace InputLog {
+    constexpr std::array<char, 4> magic = { 'S', 'S', 'I', 'R' };
+    constexpr std::uint8_t version = 1;
+
+    struct Run {
+        ActionSet actions_;
+        std::uint16_t length_;
+    };
+}
+
+class InputRecorder {
+public:
+    explicit InputRecorder(unsigned int ticksPerSecond) : ticksPerSecond_(ticksPerSecond), tickCount_(0) {}
+
+    void record(ActionSet actions) {
+        if (!runs_.empty() && runs_.back().actions_ == actions
+            && runs_.back().length_ < std::numeric_limits<std::uint16_t>::max()) {
+            ++runs_.back().length_;
+        }
+        else {
+            runs_.push_back({ actions, 1 });
+        }
+        ++tickCount_;
+    }
+
+    void save(const std::filesystem::path& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Can't write input log: " + path.string());
+        }
+
+        auto put = [&file](std::uint32_t value, int bytes) {
+            for (int i = 0; i < bytes; ++i) {
+                file.put(static_cast<char>((value >> (8 * i)) & 0xFFu));
+            }
+            };
+
+        file.write(InputLog::magic.data(), InputLog::magic.size());
+        put(InputLog::version, 1);
+        put(ticksPerSecond_, 2);
+        put(tickCount_, 4);
+        for (const InputLog::Run& run : runs_) {
+            put(run.actions_, 1);
+            put(run.length_, 2);
+        }
+    }
+
+    std::uint32_t getTickCount() const {
+        return tickCount_;
+    }
+
+private:
+    unsigned int ticksPerSecond_;
+    std::uint32_t tickCount_;
+    std::vector<InputLog::Run> runs_;
+};
+
+// Plays an InputRecorder log back one tick at a time
+class InputReplay {
+public:
+    explicit InputReplay(const std::filesystem::path& path) : ticksPerSecond_(0), tickCount_(0), tick_(0), run_(0), offset_(0) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Can't open input log: " + path.string());
+        }
+
+        auto get = [&file, &path](int bytes) {
+            std::uint32_t value = 0;
+            for (int i = 0; i < bytes; ++i) {
+                const int byte = file.get();
+                if (byte == std::char_traits<char>::eof()) {
+                    throw std::runtime_error("Truncated input log: " + path.string());
+                }
+                value |= static_cast<std::uint32_t>(byte) << (8 * i);
+            }
+            return value;
+            };
+
+        std::array<char, 4> magic{};
+        file.read(magic.data(), magic.size());
+        if (magic != InputLog::magic || get(1) != InputLog::version) {
+            throw std::runtime_error("Not an input log: " + path.string());
+        }
+        ticksPerSecond_ = get(2);
+        tickCount_ = get(4);
+
+        for (std::uint32_t ticks = 0; ticks < tickCount_;) {
+            const auto actions = static_cast<ActionSet>(get(1));
+            const auto length = static_cast<std::uint16_t>(get(2));
+            if (length == 0) {
+                throw std::runtime_error("Corrupt input log: " + path.string());
+            }
+            runs_.push_back({ actions, length });
+            ticks += length;
+        }
+    }
+
+    // Actions for the next tick; empty once the log has run out
+    ActionSet next() {
+        if (isFinished()) {
+            return 0;
+        }
+        const ActionSet actions = runs_[run_].actions_;
+        if (++offset_ == runs_[run_].length_) {
+            ++run_;
+            offset_ = 0;
+        }
+        ++tick_;
+        return actions;
+    }
+
+    bool isFinished() const {
+        return tick_ >= tickCount_;
+    }
+
+    unsigned int getTicksPerSecond() const {
+        return ticksPerSecond_;
+    }
+
+    std::uint32_t getTickCount() const {
+        return tickCount_;
+    }
+
+private:
+    unsigned int ticksPerSecond_;
+    std::uint32_t tickCount_;
+    std::uint32_t tick_;
+    std::size_t run_;
+    std::uint16_t offset_;
+    std::vector<InputLog::Run> runs_;
+};
+
+class Player {
+public:
+    enum Action {
+        MoveLeft,
+        MoveRight,
+        MoveUp,
+        MoveDown,
+        Fire,
+        ActionCount
+    };
+    static_assert(ActionCount <= std::numeric_limits<ActionSet>::digits, "ActionSet is too narrow");
+
+    Player() {
+        constexpr float playerSpeed = 200.f;
+
+        actionByKey_.fill(ActionCount);
+        keyByAction_.fill(sf::Keyboard::Key::Unknown);
+
+        addKeys(MoveLeft, sf::Keyboard::Key::Left);
+        addKeys(MoveRight, sf::Keyboard::Key::Right);
+        addKeys(MoveUp, sf::Keyboard::Key::Up);
+        addKeys(MoveDown, sf::Keyboard::Key::Down);
+        addKeys(Fire, sf::Keyboard::Key::Space);
+
+        commands_[MoveUp].action_ = [playerSpeed](SceneNode& node, sf::Time dt) {
+            node.move({ 0.f, -playerSpeed * dt.asSeconds() });
+            };
+
+        commands_[MoveDown].action_ = [playerSpeed](SceneNode& node, sf::Time dt) {
+            node.move({ 0.f, playerSpeed * dt.asSeconds() });
+            };
+
+        commands_[MoveRight].action_ = [playerSpeed](SceneNode& node, sf::Time dt) {
+            node.move({ playerSpeed * dt.asSeconds(), 0.f });
+            };
+
+        commands_[MoveLeft].action_ = [playerSpeed](SceneNode& node, sf::Time dt) {
+            node.move({ -playerSpeed * dt.asSeconds(), 0.f });
+            };
+
+        commands_[Fire].action_ = [](SceneNode& node, sf::Time) {
+            static_cast<Aircraft&>(node).fire();
+            };
+
+        for (auto& command : commands_) {
+            command.category_ = Category::PlayerAircraft;
+        }
+    }
+
+    // Binds key to action, dropping whatever either of them was bound to before
+    void addKeys(Action action, sf::Keyboard::Key key) {
+        assert(action < ActionCount && "Invalid action");
+        if (const sf::Keyboard::Key old = keyByAction_[action]; old != sf::Keyboard::Key::Unknown) {
+            actionByKey_[keyIndex(old)] = ActionCount;
+        }
+        if (key == sf::Keyboard::Key::Unknown) {
+            keyByAction_[action] = key;
+            return;
+        }
+        if (const Action old = actionByKey_[keyIndex(key)]; old != ActionCount) {
+            keyByAction_[old] = sf::Keyboard::Key::Unknown;
+        }
+        actionByKey_[keyIndex(key)] = action;
+        keyByAction_[action] = key;
+    }
+
+    void addKeys(const std::string& id, const sf::Keyboard::Key key) {
+        addKeys(toAction(id), key);
+    }
+
+    void assignCommand(Action action, Command c) {
+        assert(action < ActionCount && "Invalid action");
+        commands_[action] = std::move(c);
+    }
+
+    void assignCommand(const std::string& id, Command c) {
+        assignCommand(toAction(id), std::move(c));
+    }
+
+    sf::Keyboard::Key getAssignKey(Action action) const {
+        return keyByAction_[action];
+    }
+
+    sf::Keyboard::Key getAssignKey(const std::string& action) const {
+        return getAssignKey(toAction(action));
+    }
+
+    // Reads "<Action> <Key>" pairs, one per line; '#' starts a comment
+    void loadBindings(const std::filesystem::path& path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Can't open key bindings: " + path.string());
+        }
+
+        std::string line;
+        while (std::getline(file, line)) {
+            line.erase(std::ranges::find(line, '#'), line.end());
+            std::istringstream fields(line);
+            std::string action;
+            std::string key;
+            if (!(fields >> action)) {
+                continue;
+            }
+            if (!(fields >> key)) {
+                throw std::runtime_error("Missing key for action " + action + " in " + path.string());
+            }
+            addKeys(toAction(action), toKey(key));
+        }
+    }
+
+    void handleEvent(const sf::Event& event, CommandQueue& commands) {
+        if (const auto* keyPressed = event.getIf<sf::Event::KeyPressed>()) {
+            if (keyPressed->scancode == sf::Keyboard::Scancode::P) {
+                Command output;
+                output.category_ = Category::PlayerAircraft;
+                output.action_ = [](SceneNode& s, sf::Time) {
+                    std::cout << s.getPosition().x << ","
+                        << s.getPosition().y << "\n";
+                    };
+                commands.emplace(std::move(output));
+            }
+        }
+    }
+
+    static bool isRealtimeAction(Action action) {
+        switch (action) {
+        case MoveLeft:
+        case MoveRight:
+        case MoveUp:
+        case MoveDown:
+        case Fire:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Called once per fixed tick. A replay, if set, stands in for the keyboard;
+    // a recorder, if set, logs whichever of the two was used.
+    void handleRealtimeInput(CommandQueue& c) {
+        const ActionSet actions = replay_ ? replay_->next() : readRealtimeActions();
+        if (recorder_) {
+            recorder_->record(actions);
+        }
+        issueActions(actions, c);
+    }
+
+    ActionSet readRealtimeActions() const {
+        ActionSet actions = 0;
+        for (std::size_t action = 0; action < ActionCount; ++action) {
+            const sf::Keyboard::Key key = keyByAction_[action];
+            if (key != sf::Keyboard::Key::Unknown && sf::Keyboard::isKeyPressed(key)
+                && isRealtimeAction(static_cast<Action>(action))) {
+                actions |= static_cast<ActionSet>(1u << action);
+            }
+        }
+        return actions;
+    }
+
+    void issueActions(ActionSet actions, CommandQueue& c) const {
+        for (std::size_t action = 0; action < ActionCount; ++action) {
+            if (actions & (1u << action)) {
+                c.emplace(commands_[action].clone());
+            }
+        }
+    }
+
+    void setRecorder(InputRecorder* recorder) {
+        recorder_ = recorder;
+    }
+
+    void setReplay(InputReplay* replay) {
+        replay_ = replay;
+    }
+
+private:
+    static std::size_t keyIndex(sf::Keyboard::Key key) {
+        assert(key != sf::Keyboard::Key::Unknown && "Unknown key has no slot");
+        return static_cast<std::size_t>(key);
+    }
+
+    static Action toAction(const std::string& id) {
+        static constexpr std::array<std::pair<std::string_view, Action>, ActionCount> names = { {
+            { "MoveLeft", MoveLeft },
+            { "MoveRight", MoveRight },
+            { "MoveUp", MoveUp },
+            { "MoveDown", MoveDown },
+            { "Fire", Fire },
+        } };
+        for (const auto& [name, action] : names) {
+            if (name == id) return action;
+        }
+        throw std::runtime_error("Unknown action: " + id);
+    }
+
+    static sf::Keyboard::Key toKey(const std::string& id) {
+        using Key = sf::Keyboard::Key;
+        if (id.size() == 1 && std::isalpha(static_cast<unsigned char>(id[0]))) {
+            return static_cast<Key>(static_cast<int>(Key::A) + (std::toupper(static_cast<unsigned char>(id[0])) - 'A'));
+        }
+        if (id.size() == 1 && std::isdigit(static_cast<unsigned char>(id[0]))) {
+            return static_cast<Key>(static_cast<int>(Key::Num0) + (id[0] - '0'));
+        }
+
+        static constexpr std::array<std::pair<std::string_view, Key>, 16> names = { {
+            { "Left", Key::Left }, { "Right", Key::Right }, { "Up", Key::Up }, { "Down", Key::Down },
+            { "Space", Key::Space }, { "Enter", Key::Enter }, { "Escape", Key::Escape }, { "Tab", Key::Tab },
+            { "Backspace", Key::Backspace }, { "LShift", Key::LShift }, { "RShift", Key::RShift },
+            { "LControl", Key::LControl }, { "RControl", Key::RControl }, { "LAlt", Key::LAlt },
+            { "RAlt", Key::RAlt }, { "Unbound", Key::Unknown },
+        } };
+        for (const auto& [name, key] : names) {
+            if (name == id) return key;
+        }
+        throw std::runtime_error("Unknown key: " + id);
+    }
+
+    std::array<Action, sf::Keyboard::KeyCount> actionByKey_;
+    std::array<sf::Keyboard::Key, ActionCount> keyByAction_;
+    std::array<Command, ActionCount> commands_;
+    InputRecorder* recorder_ = nullptr;
+    InputReplay* replay_ = nullptr;
+};
+
+// Simulation core: owns the scene and runs ticks, but never touches a window or
+// the GPU, so it can run headless. WorldRenderer is the matching front-end.
 class World {
 public:
 
-    World(sf::RenderWindow& window)
-        : window_(window),
-        sceneView_(window_.getDefaultView()),
+    // Marks textures the caller already acquired with acquireTextures(); the World
+    // takes those references over and releases them when it is destroyed
+    struct TexturesAcquired {};
+
+    // jobs runs the parallel scene updates; it can be shared by Worlds updated from one thread
+    World(sf::Vector2f viewSize, TextureHolder& textures, TextureAtlas& atlas, JobSystem& jobs)
+        : World(viewSize, textures, atlas, jobs, acquireTextures(textures, atlas)) {
+    }
+
+    // For building a World off the main thread: nothing here touches the holder, the
+    // atlas or the window
+    World(sf::Vector2f viewSize, TextureHolder& textures, TextureAtlas& atlas, JobSystem& jobs, TexturesAcquired)
+        : textureHolder_(textures),
+        atlas_(atlas),
+        sceneView_(sf::FloatRect({ 0.f, 0.f }, viewSize)),
         worldBounds_({ 0.f, 0.f }, { sceneView_.getSize().x, 2000.f }),
         spawnPosition_(worldBounds_.size.x / 2.f, worldBounds_.size.y - sceneView_.getSize().y / 2.f),
         playerAircraft_(nullptr),
-        scrollSpeed_(50.f) {
-        loadTextures();
+        scrollSpeed_(50.f),
+        collisionGrid_(worldBounds_, 128.f),
+        jobs_(jobs),
+        particles_(maxParticles_),
+        random_(1234) {
+        start();
+    }
+
+    ~World() {
+        for (const Textures::ID id : textureIds_) {
+            textureHolder_.release(id);
+        }
+    }
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // Back to the start of the level, keeping threads, pools and textures
+    void reset() {
+        for (SceneNode* layer : sceneLayers_) {
+            layer->markForRemoval();
+        }
+        sceneGraph_.removeWrecks();
+        backgrounds_.clear();
+        entities_.clear();
+        particles_.clear();
+        while (!commandQueue_.isEmpty()) {
+            commandQueue_.pop();
+        }
+        enemySpawns_ = {};
+        soundEventCount_ = 0;
+        random_.seed(1234);
+        start();
+    }
+
+    void update(sf::Time dt) {
+        ProfileScope profile("World::update");
+        AllocationScope allocations(AllocationCounter::WorldUpdate);
+
+        soundEventCount_ = 0;
+
+        // Drop everything marked for removal last tick in one compaction pass
+        sceneGraph_.removeWrecks();
+        sceneGraph_.savePreviousState();
+        previousViewCenter_ = sceneView_.getCenter();
+
+        // Handle commands first; only scene-wide commands still walk the whole graph
+        Profiler::instance().setCounter(Profiler::CommandQueueDepth, commandQueue_.size());
+        {
+            ProfileScope commands("World::commands");
+            while (!commandQueue_.isEmpty()) {
+                Command command = commandQueue_.pop();
+                if (command.category_ & Category::Scene) {
+                    sceneGraph_.onCommand(command, dt);
+                }
+                else {
+                    categoryIndex_.dispatch(command, dt);
+                }
+            }
+        }
+
+        // Normalize diagonal movement
+        sf::Vector2f velocity = playerAircraft_->getVelocity();
+        if (velocity.x != 0.f && velocity.y != 0.f)
+            playerAircraft_->setVelocity(velocity / std::sqrt(2.f));
+        playerAircraft_->accelerate(0.f, 0.f);
+
+        // Update scene; flat entities are integrated in one pass over their arrays
+        {
+            ProfileScope scene("World::scene");
+            sceneGraph_.update(dt);
+            entities_.integrate(dt, worldBounds_);
+            entities_.destroyOutside();
+            entities_.syncNodes();
+        }
+
+        // Bullets leave from where the aircraft moved to this tick
+        {
+            ProfileScope particles("World::particles");
+            if (playerAircraft_->launch()) {
+                launchProjectiles(*playerAircraft_);
+                requestSound(SoundEffects::Fire);
+            }
+            particles_.update(dt, worldBounds_);
+        }
+
+        // Keep player aircraft within bounds using clamp
+        {
+            ProfileScope clamp("World::clamp");
+            sf::FloatRect viewBounds(
+                sceneView_.getCenter() - sceneView_.getSize() / 2.f,
+                sceneView_.getSize());
+
+            const float borderDistance = 40.f;
+            sf::Vector2f position = playerAircraft_->getPosition();
+
+            position.x = std::clamp(
+                position.x,
+                viewBounds.position.x + borderDistance,
+                viewBounds.position.x + viewBounds.size.x - borderDistance
+            );
+            position.y = std::clamp(
+                position.y,
+                viewBounds.position.y + borderDistance,
+                viewBounds.position.y + viewBounds.size.y - borderDistance
+            );
+
+            playerAircraft_->setPosition(position);
+
+            // Update camera to follow player
+            sceneView_.setCenter(playerAircraft_->getPosition());
+        }
+
+        streamBackgrounds();
+        spawnEnemies();
+        despawnEnemies();
+        updateCollisionGrid();
+        resolveHits();
+        Profiler::instance().setCounter(Profiler::Nodes, getNodeCount());
+        Profiler::instance().setCounter(Profiler::Particles, particles_.size());
+    }
+
+    // Camera blended between the previous and current tick
+    sf::View getInterpolatedView(float alpha) const {
+        sf::View view = sceneView_;
+        view.setCenter(previousViewCenter_ + (sceneView_.getCenter() - previousViewCenter_) * alpha);
+        return view;
+    }
+
+    // Submits everything drawable to queue; culling is up to the queue's cull rect
+    void collect(RenderQueue& queue, float alpha) const {
+        sceneGraph_.collect(queue, sf::Transform::Identity, alpha);
+        entities_.submit(queue, Air, alpha);
+        particles_.submit(queue, Effects, alpha);
+    }
+
+    std::size_t getNodeCount() const {
+        return categoryIndex_.getNodeCount(~0u) + entities_.size();
+    }
+
+    Aircraft& getPlayerAircraft() {
+        return *playerAircraft_;
+    }
+
+    CommandQueue& getCommandQueue() {
+        return commandQueue_;
+    }
+
+    EntityStore& getEntities() {
+        return entities_;
+    }
+
+    ParticleSystem& getParticles() {
+        return particles_;
+    }
+
+    // Sounds asked for during the last tick; World has no audio, so its owner plays them
+    std::span<const SoundEffects::ID> getSoundEvents() const {
+        return std::span(soundEvents_.data(), soundEventCount_);
+    }
+
+    // Enemies are created lazily from this as the camera approaches them
+    void setSpawnSchedule(SpawnSchedule schedule) {
+        enemySpawns_ = std::move(schedule);
+        spawnEnemies();
+    }
+
+    const SpatialGrid<SceneNode*>& getCollisionGrid() const {
+        return collisionGrid_;
+    }
+
+    static const auto& getTextures() {
+        return textureIds_;
+    }
+
+    static const auto& getSprites() {
+        return spriteIds_;
+    }
+
+    // Main thread only. Shared holder: only the first World in the process actually
+    // reads these from disk. Atlas pages are decoded here but uploaded by the renderer.
+    static TexturesAcquired acquireTextures(TextureHolder& textures, TextureAtlas& atlas) {
+        for (const Textures::ID id : textureIds_) {
+            textures.load(id);
+        }
+        for (const Textures::ID id : spriteIds_) {
+            atlas.load(id);
+        }
+        return {};
+    }
+
+private:
+    enum Layer {
+        Background,
+        Air,
+        Effects,
+        LayerCount
+    };
+
+    static constexpr std::size_t maxParticles_ = 1 << 15;
+
+    static constexpr unsigned int collidableCategories_ =
+        Category::PlayerAircraft | Category::AlliedAircraft | Category::EnemyAircraft;
+
+    // Enemies are built just before they scroll into view
+    void spawnEnemies() {
+        constexpr float spawnMargin = 150.f;
+        const float top = sceneView_.getCenter().y - sceneView_.getSize().y / 2.f - spawnMargin;
+        const float bottom = sceneView_.getCenter().y + sceneView_.getSize().y / 2.f + spawnMargin;
+
+        enemySpawns_.consume(top, bottom, [this](const SpawnSchedule::Spawn& spawn) {
+            const Textures::ID texture = spawn.type_ == Aircraft::Eagle ? Textures::Eagle : Textures::Raptor;
+            auto enemy = nodePool_.make<Aircraft>(spawn.type_, atlas_.get(texture), true);
+            enemy->setPosition(spawn.position_);
+            // Spawned after this tick's snapshot; without one it would be drawn sliding in from the origin
+            enemy->savePreviousState();
+            enemy->setVelocity(spawn.velocity_);
+            sceneLayers_[Air]->addChild(std::move(enemy));
+            });
+    }
+
+    // ...and dropped once they leave the world or fall a screen behind the camera
+    void despawnEnemies() {
+        const sf::Vector2f keep = sceneView_.getSize() * 1.5f;
+        const sf::FloatRect alive(sceneView_.getCenter() - keep, keep * 2.f);
+        categoryIndex_.forEach(Category::EnemyAircraft, [&](SceneNode& enemy) {
+            const sf::FloatRect bounds = enemy.getBoundingRect();
+            if (!enemy.isMarkedForRemoval() && (!worldBounds_.findIntersection(bounds) || !alive.findIntersection(bounds))) {
+                enemy.markForRemoval();
+            }
+            });
+    }
+
+    void start() {
         buildScene();
         sceneView_.setCenter(spawnPosition_);
+        streamBackgrounds();
+        sceneGraph_.savePreviousState();
+        previousViewCenter_ = sceneView_.getCenter();
+    }
+
+    // More than this per tick would be inaudible in the mix anyway
+    void requestSound(SoundEffects::ID id) {
+        if (soundEventCount_ < soundEvents_.size()) {
+            soundEvents_[soundEventCount_++] = id;
+        }
+    }
+
+    void launchProjectiles(const Aircraft& aircraft) {
+        const sf::FloatRect bounds = aircraft.getBoundingRect();
+        const float muzzleY = bounds.position.y;
+        for (const float muzzleX : { bounds.position.x + bounds.size.x * 0.3f, bounds.position.x + bounds.size.x * 0.7f }) {
+            particles_.emit({ muzzleX, muzzleY }, { 0.f, -900.f }, sf::seconds(2.f), sf::Color(255, 240, 120), 6.f,
+                Category::EnemyAircraft);
+        }
+    }
+
+    // Player bullets against the broad phase; whatever they hit blows up. A node
+    // already destroyed this tick is still in the grid but lets bullets through.
+    void resolveHits() {
+        ProfileScope profile("World::hits");
+        particles_.collide(collisionGrid_, [this](SceneNode* target, sf::Vector2f position) {
+            if (target->isMarkedForRemoval()) {
+                return false;
+            }
+            target->markForRemoval();
+            explode(position);
+            requestSound(SoundEffects::Explosion);
+            return true;
+            });
+    }
+
+    void explode(sf::Vector2f position) {
+        constexpr int sparkCount = 48;
+        std::uniform_real_distribution<float> angle(0.f, 2.f * std::numbers::pi_v<float>);
+        std::uniform_real_distribution<float> speed(60.f, 260.f);
+        std::uniform_real_distribution<float> lifetime(0.3f, 0.9f);
+        for (int i = 0; i < sparkCount; ++i) {
+            const float direction = angle(random_);
+            const sf::Vector2f velocity = sf::Vector2f(std::cos(direction), std::sin(direction)) * speed(random_);
+            particles_.emit(position, velocity, sf::seconds(lifetime(random_)), sf::Color(255, 150, 40), 4.f);
+        }
+    }
+
+    void streamBackgrounds() {
+        const sf::FloatRect view(sceneView_.getCenter() - sceneView_.getSize() / 2.f, sceneView_.getSize());
+        for (TiledBackground* background : backgrounds_) {
+            background->stream(view);
+        }
+    }
+
+    void updateCollisionGrid() {
+        ProfileScope profile("World::collisionGrid");
+        collisionGrid_.beginUpdate();
+        // Nodes on their way out are left to drop out of the grid
+        categoryIndex_.forEach(collidableCategories_, [this](SceneNode& node) {
+            if (!node.isMarkedForRemoval()) {
+                collisionGrid_.update(&node, node.getBoundingRect(), node.getCategory());
+            }
+            });
+        collisionGrid_.endUpdate();
+    }
+
+    // The background repeats, so it can't live in the atlas
+    static constexpr std::array<Textures::ID, 1> textureIds_ = {
+        Textures::Space,
+    };
+
+    static constexpr std::array<Textures::ID, 2> spriteIds_ = {
+        Textures::Eagle,
+        Textures::Raptor,
+    };
+
+    void buildScene() {
+        sceneGraph_.setCategoryIndex(&categoryIndex_);
+
+        for (size_t i = 0; i < LayerCount; ++i) {
+            SceneNode::Ptr layer = nodePool_.make<SceneNode>();
+            layer->setRenderLayer(static_cast<unsigned int>(i));
+            // Air entities overlap rarely enough that removal order doesn't matter
+            layer->setStableOrder(i != Air);
+            if (i == Air) {
+                layer->setParallelUpdate(&jobs_);
+            }
+            sceneLayers_[i] = layer.get();
+            sceneGraph_.addChild(std::move(layer));
+        }
+
+        // One texture-sized tile per cell; add more TiledBackgrounds with parallax < 1 for depth
+        const sf::Texture& backgroundTex = textureHolder_.get(Textures::Space);
+        const TextureRegion backgroundTile{ &backgroundTex, sf::IntRect({ 0, 0 }, sf::Vector2i(backgroundTex.getSize())) };
+        // Placeholder textures (headless benchmarks) have no size; tile those at screen size
+        const sf::Vector2f tileSize = backgroundTex.getSize().x > 0 && backgroundTex.getSize().y > 0
+            ? sf::Vector2f(backgroundTex.getSize()) : sceneView_.getSize();
+        auto background = nodePool_.make<TiledBackground>(tileSize,
+            [backgroundTile](sf::Vector2i) { return backgroundTile; });
+        backgrounds_.push_back(background.get());
+        sceneLayers_[Background]->addChild(std::move(background));
+
+        auto leader = nodePool_.make<Aircraft>(Aircraft::Eagle, atlas_.get(Textures::Eagle));
+        playerAircraft_ = leader.get();
+        playerAircraft_->setPosition(spawnPosition_);
+        playerAircraft_->setVelocity(0.f, scrollSpeed_);
+        sceneLayers_[Air]->addChild(std::move(leader));
+
+        auto leftEscort = nodePool_.make<Aircraft>(Aircraft::Raptor, atlas_.get(Textures::Raptor));
+        leftEscort->setPosition({ -80.f, 50.f });
+        playerAircraft_->addChild(std::move(leftEscort));
+
+        auto rightEscort = nodePool_.make<Aircraft>(Aircraft::Raptor, atlas_.get(Textures::Raptor));
+        rightEscort->setPosition({ 80.f, 50.f });
+        playerAircraft_->addChild(std::move(rightEscort));
+    }
+
+    TextureHolder& textureHolder_;
+    TextureAtlas& atlas_;
+    sf::View sceneView_;
+    sf::Vector2f previousViewCenter_;
+    sf::FloatRect worldBounds_;
+    sf::Vector2f spawnPosition_;
+    Aircraft* playerAircraft_;
+    float scrollSpeed_;
+    SpatialGrid<SceneNode*> collisionGrid_;
+    CommandQueue commandQueue_;
+    std::array<SceneNode*, LayerCount> sceneLayers_;
+    std::vector<TiledBackground*> backgrounds_;
+    SpawnSchedule enemySpawns_;
+    JobSystem& jobs_;
+    NodePool nodePool_;
+    CategoryIndex categoryIndex_;
+    SceneNode sceneGraph_;
+    EntityStore entities_;
+    ParticleSystem particles_;
+    std::minstd_rand random_; // Effects only; fixed seed keeps replays and benchmarks repeatable
+    std::array<SoundEffects::ID, 16> soundEvents_{};
+    std::size_t soundEventCount_ = 0;
+};
+
+// A frame described by value, so it can be built on one thread and drawn on
+// another. Each pass sets a view, draws its loose drawables in order, then its
+// batched quads (scene sprites and text) on top. Textures and fonts are
+// referenced, not copied: their holders outlive every snapshot. Slots are
+// reused between frames, so a steady scene captures without allocating.
+class RenderSnapshot {
+public:
+    using Item = std::variant<sf::Sprite, sf::RectangleShape>;
+
+    void clear() {
+        passCount_ = 0;
+        atlas_ = nullptr;
+    }
+
+    // Starts a new pass; without a view the target's default view is used
+    RenderQueue& beginPass(const std::optional<sf::View>& view = std::nullopt) {
+        if (passCount_ == passes_.size()) {
+            passes_.emplace_back();
+        }
+        Pass& pass = passes_[passCount_++];
+        pass.view_ = view;
+        pass.itemCount_ = 0;
+        pass.queue_.setCullRect(std::nullopt);
+        return pass.queue_;
+    }
+
+    template <typename Drawable>
+    void add(const Drawable& drawable) {
+        assert(passCount_ > 0 && "beginPass() must come first");
+        Pass& pass = passes_[passCount_ - 1];
+        if (pass.itemCount_ < pass.items_.size()) {
+            pass.items_[pass.itemCount_] = drawable;
+        }
+        else {
+            pass.items_.emplace_back(drawable);
+        }
+        ++pass.itemCount_;
+    }
+
+    // Pages added since the last upload are sent to the GPU by whoever draws
+    void uploadBeforeDraw(TextureAtlas& atlas) {
+        atlas_ = &atlas;
+    }
+
+    void draw(sf::RenderTarget& target) {
+        ProfileScope profile("RenderSnapshot::draw");
+        if (atlas_) {
+            atlas_->upload();
+        }
+
+        std::size_t drawCalls = 0;
+        for (Pass& pass : std::span(passes_.data(), passCount_)) {
+            target.setView(pass.view_ ? *pass.view_ : target.getDefaultView());
+            for (const Item& item : std::span(pass.items_.data(), pass.itemCount_)) {
+                std::visit([&target](const auto& drawable) { target.draw(drawable); }, item);
+            }
+            pass.queue_.draw(target);
+            drawCalls += pass.queue_.getDrawCallCount() + pass.itemCount_;
+        }
+        Profiler::instance().setCounter(Profiler::DrawCalls, drawCalls);
+    }
+
+private:
+    struct Pass {
+        std::optional<sf::View> view_;
+        RenderQueue queue_;
+        std::vector<Item> items_;
+        std::size_t itemCount_ = 0;
+    };
+
+    std::vector<Pass> passes_;
+    std::size_t passCount_ = 0;
+    TextureAtlas* atlas_ = nullptr;
+};
+
+// Render front-end for a World: uploads pending atlas pages, sets the camera,
+// culls against the view and draws the batched scene into any render target.
+class WorldRenderer {
+public:
+    explicit WorldRenderer(TextureAtlas& atlas) : atlas_(atlas) {}
+
+    void draw(const World& world, sf::RenderTarget& target, float alpha = 1.f) {
+        atlas_.upload();
+
+        const sf::View view = world.getInterpolatedView(alpha);
+        target.setView(view);
+
+        renderQueue_.setCullRect(getCullRect(view));
+        world.collect(renderQueue_, alpha);
+        renderQueue_.draw(target);
+
+        Profiler::instance().setCounter(Profiler::DrawCalls, renderQueue_.getDrawCallCount());
+    }
+
+    // Same as draw(), but records into a snapshot pass for another thread to draw
+    void capture(const World& world, RenderSnapshot& snapshot, float alpha = 1.f) const {
+        snapshot.uploadBeforeDraw(atlas_);
+
+        const sf::View view = world.getInterpolatedView(alpha);
+        RenderQueue& queue = snapshot.beginPass(view);
+        queue.setCullRect(getCullRect(view));
+        world.collect(queue, alpha);
+    }
+
+    const RenderQueue& getRenderQueue() const {
+        return renderQueue_;
+    }
+
+private:
+    // The visible slice, padded for interpolation and rotated sprites
+    static sf::FloatRect getCullRect(const sf::View& view) {
+        constexpr float cullMargin = 64.f;
+        return sf::FloatRect(
+            view.getCenter() - view.getSize() / 2.f - sf::Vector2f(cullMargin, cullMargin),
+            view.getSize() + sf::Vector2f(cullMargin, cullMargin) * 2.f);
+    }
+
+    TextureAtlas& atlas_;
+    RenderQueue renderQueue_;
+};
+
+// Two snapshots handed back and forth between a producer (simulation) and a
+// consumer (render) thread. The producer fills one while the consumer draws
+// the other, so it can run at most one frame ahead.
+class FramePipeline {
+public:
+    FramePipeline() : slots_{ Slot::Free, Slot::Free }, captureIndex_(0), drawIndex_(0), finished_(false) {}
+
+    // Producer: waits for a free snapshot; nullptr if stop was requested meanwhile
+    RenderSnapshot* beginCapture(std::stop_token stop) {
+        std::unique_lock lock(mutex_);
+        if (!changed_.wait(lock, stop, [this] { return slots_[captureIndex_] == Slot::Free; })) {
+            return nullptr;
+        }
+        RenderSnapshot& snapshot = snapshots_[captureIndex_];
+        snapshot.clear();
+        return &snapshot;
+    }
+
+    void endCapture() {
+        {
+            std::scoped_lock lock(mutex_);
+            slots_[captureIndex_] = Slot::Ready;
+            captureIndex_ ^= 1;
+        }
+        changed_.notify_all();
+    }
+
+    // Producer: no more frames will come
+    void finish() {
+        {
+            std::scoped_lock lock(mutex_);
+            finished_ = true;
+        }
+        changed_.notify_all();
+    }
+
+    // Consumer: waits for the next frame; nullptr once the producer has finished
+    RenderSnapshot* beginDraw() {
+        std::unique_lock lock(mutex_);
+        changed_.wait(lock, [this] { return slots_[drawIndex_] == Slot::Ready || finished_; });
+        if (slots_[drawIndex_] != Slot::Ready) {
+            return nullptr;
+        }
+        slots_[drawIndex_] = Slot::Drawing;
+        return &snapshots_[drawIndex_];
     }
 
-    void update(sf::Time dt) {
-        // Handle commands first
-        while (!commandQueue_.isEmpty()) {
-            sceneGraph_.onCommand(commandQueue_.pop(), dt);
+    void endDraw() {
+        {
+            std::scoped_lock lock(mutex_);
+            slots_[drawIndex_] = Slot::Free;
+            drawIndex_ ^= 1;
         }
+        changed_.notify_all();
+    }
 
-        // Normalize diagonal movement
-        sf::Vector2f velocity = playerAircraft_->getVelocity();
-        if (velocity.x != 0.f && velocity.y != 0.f)
-            playerAircraft_->setVelocity(velocity / std::sqrt(2.f));
-        playerAircraft_->accelerate(0.f, 0.f);
+private:
+    enum class Slot {
+        Free,
+        Ready,
+        Drawing,
+    };
 
-        // Update scene
-        sceneGraph_.update(dt);
+    std::array<RenderSnapshot, 2> snapshots_;
+    std::array<Slot, 2> slots_;
+    std::size_t captureIndex_;
+    std::size_t drawIndex_;
+    bool finished_;
+    std::mutex mutex_;
+    std::condition_variable_any changed_;
+};
 
-        // Keep player aircraft within bounds using clamp
-        sf::FloatRect viewBounds(
-            sceneView_.getCenter() - sceneView_.getSize() / 2.f,
-            sceneView_.getSize());
+// Accumulates real frame time and hands it out in fixed-size simulation ticks.
+// A tick rate of 0 falls back to one variable-length step per frame.
+class FixedTimestep {
+public:
+    explicit FixedTimestep(unsigned int ticksPerSecond = 60, unsigned int maxStepsPerFrame = 5)
+        : timePerTick_(ticksPerSecond > 0 ? sf::seconds(1.f / static_cast<float>(ticksPerSecond)) : sf::Time::Zero),
+        maxStepsPerFrame_(std::max(maxStepsPerFrame, 1u)),
+        accumulator_(sf::Time::Zero),
+        pendingVariableStep_(false) {
+    }
 
-        const float borderDistance = 40.f;
-        sf::Vector2f position = playerAircraft_->getPosition();
+    void advance(sf::Time elapsed) {
+        if (!isFixed()) {
+            accumulator_ = elapsed;
+            pendingVariableStep_ = true;
+            return;
+        }
 
-        position.x = std::clamp(
-            position.x,
-            viewBounds.position.x + borderDistance,
-            viewBounds.position.x + viewBounds.size.x - borderDistance
-        );
-        position.y = std::clamp(
-            position.y,
-            viewBounds.position.y + borderDistance,
-            viewBounds.position.y + viewBounds.size.y - borderDistance
-        );
+        // Drop time we can't catch up on instead of spiralling into ever longer frames
+        accumulator_ = std::min(accumulator_ + elapsed, timePerTick_ * static_cast<std::int64_t>(maxStepsPerFrame_));
+    }
 
-        playerAircraft_->setPosition(position);
+    bool step() {
+        if (!isFixed()) {
+            return std::exchange(pendingVariableStep_, false);
+        }
+        if (accumulator_ < timePerTick_) {
+            return false;
+        }
+        accumulator_ -= timePerTick_;
+        return true;
+    }
 
-        // Update camera to follow player
-        sceneView_.setCenter(playerAircraft_->getPosition());
+    sf::Time getTimePerTick() const {
+        return isFixed() ? timePerTick_ : accumulator_;
     }
 
-    void draw() {
-        window_.setView(sceneView_);
-        window_.draw(sceneGraph_);
+    float getInterpolation() const {
+        return isFixed() ? accumulator_ / timePerTick_ : 1.f;
     }
 
-    CommandQueue& getCommandQueue() {
-        return commandQueue_;
+    bool isFixed() const {
+        return timePerTick_ > sf::Time::Zero;
     }
 
 private:
-    enum Layer {
-        Background,
-        Air,
-        LayerCount
-    };
-
-    void loadTextures() {
-        textureHolder_.load("Textures/Space.png");
-        textureHolder_.load("Textures/Eagle.png");
-        textureHolder_.load("Textures/Raptor.png");
-    }
+    sf::Time timePerTick_;
+    unsigned int maxStepsPerFrame_;
+    sf::Time accumulator_;
+    bool pendingVariableStep_;
+};
 
-    void buildScene() {
-        for (size_t i = 0; i < LayerCount; ++i) {
-            SceneNode::Ptr layer = std::make_unique<SceneNode>();
-            sceneLayers_[i] = layer.get();
-            sceneGraph_.addChild(std::move(layer));
-        }
+// Decides how long each frame lasts. VSync leaves it to the driver; TargetRate
+// sleeps for most of the frame and spins the rest, because OS sleeps overshoot
+// by up to a scheduler tick. Frames that present nothing are always paced to
+// the target rate, so an idle screen doesn't spin even with vsync on.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
 
-        sf::Texture& backgroundTex = textureHolder_.get("Textures/Space.png");
-        backgroundTex.setRepeated(true);
+    enum Mode {
+        Unlimited,
+        VSync,
+        TargetRate,
+    };
 
-        sf::IntRect backgroundRect(
-            { 0, 0 },
-            { static_cast<int>(worldBounds_.size.x), static_cast<int>(worldBounds_.size.y) }
-        );
+    explicit FramePacer(Mode mode = VSync, unsigned int targetFps = 60)
+        : mode_(mode),
+        period_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / std::max(targetFps, 1u)))),
+        next_(Clock::now()) {
+    }
 
-        auto background = std::make_unique<SpriteNode>(backgroundTex, backgroundRect);
-        background->setPosition(worldBounds_.position);
-        sceneLayers_[Background]->addChild(std::move(background));
+    void apply(sf::Window& window) const {
+        window.setVerticalSyncEnabled(mode_ == VSync);
+    }
 
-        auto leader = std::make_unique<Aircraft>(Aircraft::Eagle, "Textures/Eagle.png", textureHolder_);
-        playerAircraft_ = leader.get();
-        playerAircraft_->setPosition(spawnPosition_);
-        playerAircraft_->setVelocity(0.f, scrollSpeed_);
-        sceneLayers_[Air]->addChild(std::move(leader));
+    // Call once per loop iteration, after display() if there was one
+    void endFrame(bool presented) {
+        const Clock::time_point now = Clock::now();
+        if (presented && mode_ != TargetRate) {
+            next_ = now;
+            return;
+        }
+        // A late frame starts the schedule over instead of rushing to catch up
+        next_ = std::max(next_ + period_, now);
+        sleepUntil(next_);
+    }
 
-        auto leftEscort = std::make_unique<Aircraft>(Aircraft::Raptor, "Textures/Raptor.png", textureHolder_);
-        leftEscort->setPosition({ -80.f, 50.f });
-        playerAircraft_->addChild(std::move(leftEscort));
+    Mode getMode() const {
+        return mode_;
+    }
 
-        auto rightEscort = std::make_unique<Aircraft>(Aircraft::Raptor, "Textures/Raptor.png", textureHolder_);
-        rightEscort->setPosition({ 80.f, 50.f });
-        playerAircraft_->addChild(std::move(rightEscort));
+private:
+    static void sleepUntil(Clock::time_point deadline) {
+        constexpr auto spinWindow = std::chrono::milliseconds(2);
+        const Clock::time_point now = Clock::now();
+        if (deadline - now > spinWindow) {
+            std::this_thread::sleep_for(deadline - now - spinWindow);
+        }
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
     }
 
-    sf::RenderWindow& window_;
-    sf::View sceneView_;
-    sf::FloatRect worldBounds_;
-    sf::Vector2f spawnPosition_;
-    Aircraft* playerAircraft_;
-    float scrollSpeed_;
-    CommandQueue commandQueue_;
-    std::array<SceneNode*, LayerCount> sceneLayers_;
-    SceneNode sceneGraph_;
-    TextureHolder textureHolder_;
+    Mode mode_;
+    Clock::duration period_;
+    Clock::time_point next_;
 };
 
 class Game {
 public:
-    Game()
+    explicit Game(unsigned int ticksPerSecond = 60)
         : window_(sf::VideoMode({ 1920u, 1080u }), "SFML Game"),
-        world_(window_) {
+        world_(sf::Vector2f(window_.getSize()), textureHolder_, atlas_, jobs_),
+        renderer_(atlas_),
+        timestep_(ticksPerSecond) {
     }
 
     void run() {
         sf::Clock clock;
         while (window_.isOpen()) {
-            processInput();
-            sf::Time dt = clock.restart();
-            update(dt);
+            timestep_.advance(clock.restart());
+            while (timestep_.step()) {
+                processInput();
+                update(timestep_.getTimePerTick());
+            }
             render();
         }
     }
@@ -467,34 +4177,367 @@ private:
 
     void render() {
         window_.clear();
-        world_.draw();
+        renderer_.draw(world_, window_, timestep_.getInterpolation());
         window_.setView(window_.getDefaultView());
         window_.display();
     }
 
     sf::RenderWindow window_;
+    TextureHolder textureHolder_;
+    TextureAtlas atlas_;
     Player player_;
+    JobSystem jobs_;
     World world_;
+    WorldRenderer renderer_;
+    FixedTimestep timestep_;
 };
 
 class FontHolder {
 public:
-    void openFile(const std::string& id, const std::filesystem::path& path) {
+    void openFile(Fonts::ID id) {
+        const std::filesystem::path path(Assets::getPath(id));
+        const std::span<const std::byte> packed = AssetPack::instance().find(id);
         std::unique_ptr<sf::Font> u = std::make_unique<sf::Font>();
-        if (!u->openFromFile(path)) {
+        if (packed.empty() ? !u->openFromFile(path) : !u->openFromMemory(packed.data(), packed.size())) {
             throw std::runtime_error("Font failed to load: " + path.string());
         }
         fonts_[id] = std::move(u);
     }
 
-    const sf::Font& getFont(const std::string& id) const {
-        auto it = fonts_.find(id);
-        assert(it != fonts_.end() && "Font not found");
-        return *(it->second);
+    void insert(Fonts::ID id, std::unique_ptr<sf::Font> font) {
+        if (!fonts_[id]) {
+            fonts_[id] = std::move(font);
+        }
+    }
+
+    bool isLoaded(Fonts::ID id) const {
+        return fonts_[id] != nullptr;
+    }
+
+    const sf::Font& getFont(Fonts::ID id) const {
+        assert(fonts_[id] && "Font not found");
+        return *fonts_[id];
+    }
+
+private:
+    std::array<std::unique_ptr<sf::Font>, Fonts::Count> fonts_;
+};
+
+// UI string laid out once into glyph quads. Glyphs come from the font's own
+// pages, where SFML rasterises each glyph once per character size, so labels
+// sharing a font and size end up in one RenderQueue batch. Layout is redone
+// only when the string or size actually changes. Bytes are read as Latin-1.
+// Only the sizes in characterSizes are allowed: prerasterize() fills their
+// pages up front, so layout from another thread never touches a texture.
+class TextLabel : public sf::Transformable {
+public:
+    static constexpr std::array<unsigned int, 4> characterSizes = { 16, 20, 30, 50 };
+
+    // Rasterises all of Latin-1 at every allowed size; call on the thread that
+    // draws, or before any label uses the font
+    static void prerasterize(const sf::Font& font) {
+        for (const unsigned int size : characterSizes) {
+            for (char32_t codePoint = U' '; codePoint <= 0xFF; ++codePoint) {
+                font.getGlyph(codePoint, size, false);
+            }
+        }
+    }
+
+    explicit TextLabel(const sf::Font& font, std::string_view string = {}, unsigned int characterSize = 30)
+        : font_(&font), page_(nullptr), string_(string), characterSize_(characterSize),
+        color_(sf::Color::White), layoutDirty_(true) {
+    }
+
+    void setString(std::string_view string) {
+        if (string != string_) {
+            string_.assign(string);
+            layoutDirty_ = true;
+        }
+    }
+
+    const std::string& getString() const {
+        return string_;
+    }
+
+    void setCharacterSize(unsigned int characterSize) {
+        if (characterSize != characterSize_) {
+            characterSize_ = characterSize;
+            layoutDirty_ = true;
+        }
+    }
+
+    void setFillColor(sf::Color color) {
+        color_ = color;
+        for (sf::Vertex& vertex : vertices_) {
+            vertex.color = color;
+        }
+    }
+
+    sf::FloatRect getLocalBounds() const {
+        ensureLayout();
+        return bounds_;
+    }
+
+    sf::FloatRect getGlobalBounds() const {
+        return getTransform().transformRect(getLocalBounds());
+    }
+
+    void batch(RenderQueue& queue, unsigned int layer = 0, const sf::Transform& transform = sf::Transform::Identity) const {
+        ensureLayout();
+        if (!vertices_.empty()) {
+            queue.append(layer, *page_, vertices_, transform * getTransform());
+        }
+    }
+
+private:
+    void ensureLayout() const {
+        if (!layoutDirty_) {
+            return;
+        }
+        layoutDirty_ = false;
+        vertices_.clear();
+        assert(std::ranges::find(characterSizes, characterSize_) != characterSizes.end()
+            && "Character size isn't prerasterised");
+
+        // Same metrics as sf::Text, so labels line up with what they replace
+        constexpr float padding = 1.f;
+        const float whitespace = font_->getGlyph(U' ', characterSize_, false).advance;
+        const float lineSpacing = font_->getLineSpacing(characterSize_);
+
+        sf::Vector2f pen(0.f, static_cast<float>(characterSize_));
+        sf::Vector2f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+        sf::Vector2f max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+        const auto extend = [&min, &max](sf::Vector2f point) {
+            min = { std::min(min.x, point.x), std::min(min.y, point.y) };
+            max = { std::max(max.x, point.x), std::max(max.y, point.y) };
+        };
+
+        char32_t previous = 0;
+        for (const char c : string_) {
+            const auto codePoint = static_cast<char32_t>(static_cast<unsigned char>(c));
+            if (codePoint == U'\r') {
+                continue;
+            }
+            pen.x += font_->getKerning(previous, codePoint, characterSize_);
+            previous = codePoint;
+
+            if (codePoint == U' ' || codePoint == U'\t' || codePoint == U'\n') {
+                extend(pen);
+                if (codePoint == U'\n') {
+                    pen = { 0.f, pen.y + lineSpacing };
+                }
+                else {
+                    pen.x += codePoint == U'\t' ? whitespace * 4.f : whitespace;
+                }
+                extend(pen);
+                continue;
+            }
+
+            const sf::Glyph& glyph = font_->getGlyph(codePoint, characterSize_, false);
+            const sf::Vector2f leftTop = pen + glyph.bounds.position - sf::Vector2f(padding, padding);
+            const sf::Vector2f rightBottom = pen + glyph.bounds.position + glyph.bounds.size + sf::Vector2f(padding, padding);
+            const sf::Vector2f texLeftTop = sf::Vector2f(glyph.textureRect.position) - sf::Vector2f(padding, padding);
+            const sf::Vector2f texRightBottom = sf::Vector2f(glyph.textureRect.position + glyph.textureRect.size) + sf::Vector2f(padding, padding);
+
+            vertices_.push_back({ leftTop, color_, texLeftTop });
+            vertices_.push_back({ { rightBottom.x, leftTop.y }, color_, { texRightBottom.x, texLeftTop.y } });
+            vertices_.push_back({ { leftTop.x, rightBottom.y }, color_, { texLeftTop.x, texRightBottom.y } });
+            vertices_.push_back({ { leftTop.x, rightBottom.y }, color_, { texLeftTop.x, texRightBottom.y } });
+            vertices_.push_back({ { rightBottom.x, leftTop.y }, color_, { texRightBottom.x, texLeftTop.y } });
+            vertices_.push_back({ rightBottom, color_, texRightBottom });
+
+            extend(pen + glyph.bounds.position);
+            extend(pen + glyph.bounds.position + glyph.bounds.size);
+            pen.x += glyph.advance;
+        }
+
+        // Looked up after the glyphs, which may have created the page
+        page_ = &font_->getTexture(characterSize_);
+        bounds_ = min.x <= max.x ? sf::FloatRect(min, max - min) : sf::FloatRect();
+    }
+
+    const sf::Font* font_;
+    mutable const sf::Texture* page_;
+    std::string string_;
+    unsigned int characterSize_;
+    sf::Color color_;
+    mutable std::vector<sf::Vertex> vertices_;
+    mutable sf::FloatRect bounds_;
+    mutable bool layoutDirty_;
+};
+
+// Effects are decoded by the loading screen and handed over with insert(), then
+// played within a fixed budget of voices, so play() never touches the disk or
+// allocates. Every effect has voiceCount
+// sf::Sound objects of its own, bound to its buffer when it loads (rebinding
+// one allocates), and an active-voice count keeps at most voiceCount playing
+// across all effects. With the budget spent, play() steals the lowest-priority,
+// then oldest, playing voice, or drops the request if everything playing
+// matters more. Call from one thread only (the one running the states).
+class SoundPlayer {
+public:
+    static constexpr std::size_t voiceCount = 16;
+
+    // Adopts a decoded buffer and binds this effect's voices to it; effects never
+    // inserted stay silent
+    void insert(SoundEffects::ID id, std::unique_ptr<sf::SoundBuffer> buffer) {
+        if (buffers_.isLoaded(id)) {
+            return;
+        }
+        buffers_.insert(id, std::move(buffer));
+        bindVoices(id);
+    }
+
+    bool isLoaded(SoundEffects::ID id) const {
+        return buffers_.isLoaded(id);
+    }
+
+    void play(SoundEffects::ID id) {
+        if (!buffers_.isLoaded(id)) {
+            return;
+        }
+
+        reclaimVoices();
+        const int priority = priorities_[id];
+        if (activeVoices_ == voiceCount) {
+            Voice* victim = nullptr;
+            for (auto& voices : voices_) {
+                for (Voice& voice : voices) {
+                    if (voice.active_ && voice.priority_ <= priority && (!victim || voice.priority_ < victim->priority_
+                        || (voice.priority_ == victim->priority_ && voice.started_ < victim->started_))) {
+                        victim = &voice;
+                    }
+                }
+            }
+            if (!victim) {
+                return;
+            }
+            victim->sound_->stop();
+            victim->active_ = false;
+            --activeVoices_;
+        }
+
+        // Fewer than voiceCount play now, so this effect has an idle voice of its own
+        Voice& voice = *std::ranges::find_if(voices_[id], [](const Voice& candidate) {
+            return !candidate.active_;
+            });
+        voice.sound_->play();
+        voice.active_ = true;
+        voice.started_ = ++playCount_;
+        ++activeVoices_;
+    }
+
+    void setVolume(float volume) {
+        volume_ = volume;
+        for (auto& voices : voices_) {
+            for (Voice& voice : voices) {
+                if (voice.sound_) {
+                    voice.sound_->setVolume(volume);
+                }
+            }
+        }
+    }
+
+    std::size_t getActiveVoiceCount() const {
+        std::size_t count = 0;
+        for (const auto& voices : voices_) {
+            count += static_cast<std::size_t>(std::ranges::count_if(voices, [](const Voice& voice) {
+                return voice.active_ && voice.sound_->getStatus() != sf::SoundSource::Status::Stopped;
+                }));
+        }
+        return count;
+    }
+
+private:
+    struct Voice {
+        std::optional<sf::Sound> sound_;
+        int priority_ = 0;
+        std::uint64_t started_ = 0;
+        bool active_ = false;
+    };
+
+    void bindVoices(SoundEffects::ID id) {
+        for (Voice& voice : voices_[id]) {
+            voice.sound_.emplace(buffers_.get(id));
+            voice.sound_->setVolume(volume_);
+            voice.priority_ = priorities_[id];
+        }
+    }
+
+    // Voices that finished on their own give their place in the budget back
+    void reclaimVoices() {
+        for (auto& voices : voices_) {
+            for (Voice& voice : voices) {
+                if (voice.active_ && voice.sound_->getStatus() == sf::SoundSource::Status::Stopped) {
+                    voice.active_ = false;
+                    --activeVoices_;
+                }
+            }
+        }
+    }
+
+    // Higher keeps its voice when they run out
+    static constexpr std::array<int, SoundEffects::Count> priorities_ = { {
+        1, // Fire
+        2, // Explosion
+    } };
+
+    SoundBufferHolder buffers_;
+    std::array<std::array<Voice, voiceCount>, SoundEffects::Count> voices_;
+    std::size_t activeVoices_ = 0;
+    std::uint64_t playCount_ = 0;
+    float volume_ = 80.f;
+};
+
+// One looping background track at a time, streamed from the pack mapping or
+// from disk. Starting the track that is already playing does nothing.
+class MusicPlayer {
+public:
+    void play(Music::ID id) {
+        if (current_ == id && music_.getStatus() != sf::SoundSource::Status::Stopped) {
+            return;
+        }
+
+        music_.stop();
+        current_.reset();
+        const std::filesystem::path path(Assets::getPath(id));
+        const std::span<const std::byte> packed = AssetPack::instance().find(id);
+        if (packed.empty() ? !music_.openFromFile(path) : !music_.openFromMemory(packed.data(), packed.size())) {
+            std::cerr << "Can't open music: " << path.string() << " (music disabled)\n";
+            return;
+        }
+        current_ = id;
+        music_.setLooping(true);
+        music_.setVolume(volume_);
+        music_.play();
+    }
+
+    void stop() {
+        music_.stop();
+        current_.reset();
+    }
+
+    void setPaused(bool paused) {
+        if (!current_) {
+            return;
+        }
+        if (paused) {
+            music_.pause();
+        }
+        else {
+            music_.play();
+        }
+    }
+
+    void setVolume(float volume) {
+        volume_ = volume;
+        music_.setVolume(volume);
     }
 
 private:
-    std::unordered_map<std::string, std::unique_ptr<sf::Font>> fonts_;
+    sf::Music music_;
+    std::optional<Music::ID> current_;
+    float volume_ = 60.f;
 };
 
 namespace States {
@@ -503,7 +4546,8 @@ namespace States {
         Menu,
         Game,
         Pause,
-        Loading
+        Loading,
+        Stats
     };
 }
 
@@ -512,21 +4556,34 @@ public:
     struct Context {
         Context(sf::RenderWindow& window,
             TextureHolder& textures,
+            TextureAtlas& atlas,
             FontHolder& fontHolder,
-            Player& player)
+            Player& player,
+            SoundPlayer& sounds,
+            MusicPlayer& music,
+            JobSystem& jobs)
             : window_(&window),
             textures_(&textures),
+            atlas_(&atlas),
             fontHolder_(&fontHolder),
-            player_(&player) {
-
-            textures_->load("Textures/Menu.png");
-            fontHolder_->openFile("RobotoMono-Italic-VariableFont_wght", "Fonts/RobotoMono-Italic-VariableFont_wght.ttf");
+            player_(&player),
+            sounds_(&sounds),
+            music_(&music),
+            jobs_(&jobs) {
+
+            // TitleState draws before LoadingState runs; everything else is loaded there
+            textures_->load(Textures::Menu);
+            fontHolder_->openFile(Fonts::Main);
         }
 
         sf::RenderWindow* window_;
         TextureHolder* textures_;
+        TextureAtlas* atlas_;
         FontHolder* fontHolder_;
         Player* player_;
+        SoundPlayer* sounds_;
+        MusicPlayer* music_;
+        JobSystem* jobs_;
     };
 
     using Ptr = std::unique_ptr<State>;
@@ -539,7 +4596,14 @@ public:
             Clear,
         };
 
-        explicit StateStack(State::Context context) : context_(context) {}
+        // Rebuilt states are destroyed when they leave the stack; cached ones are
+        // kept idle and reset() on their next push
+        enum Lifetime {
+            Rebuilt,
+            Cached,
+        };
+
+        explicit StateStack(State::Context context) : context_(context), interpolation_(1.f) {}
 
         void pushState(States::ID id) {
             pendingList_.push_back({ Push, id });
@@ -553,43 +4617,81 @@ public:
             pendingList_.push_back({ Clear, States::ID{} });
         }
 
+        // A state with a static prepare(const Context&) has it called on this thread
+        // right before every construction, wherever the constructor then runs; what
+        // it returns is passed to the constructor after the context
         template <typename T>
-        void registerState(States::ID id) {
-            factories_[id] = [this]() {
-                return std::make_unique<T>(*this, context_);
+        void registerState(States::ID id, Lifetime lifetime = Rebuilt) {
+            Registration& registration = registrations_[id];
+            registration.factory_ = [this]() -> std::function<Ptr()> {
+                if constexpr (requires(const Context& context) { T::prepare(context); }) {
+                    return [this, prepared = T::prepare(context_)]() {
+                        return std::make_unique<T>(*this, context_, prepared);
+                        };
+                }
+                else {
+                    return [this]() {
+                        return std::make_unique<T>(*this, context_);
+                        };
+                }
                 };
+            registration.lifetime_ = lifetime;
         }
 
-        Ptr createState(States::ID id) {
-            auto it = factories_.find(id);
-            if (it != factories_.end()) {
-                return it->second();
+        // Builds a cached state on a worker thread, so its next push doesn't wait
+        // for the constructor. Loading or referencing shared resources belongs in
+        // its prepare(), which still runs here; the constructor may only read what
+        // that left resident, and leaves anything audible or visible to onActivate().
+        void prewarmState(States::ID id) {
+            const auto it = registrations_.find(id);
+            if (it == registrations_.end()) {
+                return;
             }
-            return nullptr;
+            Registration& registration = it->second;
+            if (registration.lifetime_ != Cached || registration.idle_ || registration.prewarm_.valid()) {
+                return;
+            }
+            registration.prewarm_ = std::async(std::launch::async, registration.factory_());
         }
 
         void applyPendingChanges() {
+            AllocationScope allocations(AllocationCounter::StateTransitions);
             for (const auto& change : pendingList_) {
                 switch (change.action) {
                 case Push:
-                    stack_.push_back(createState(change.id));
+                    if (Ptr state = acquireState(change.id)) {
+                        stack_.push_back({ std::move(state), change.id });
+                        stack_.back().state_->onActivate();
+                    }
                     break;
                 case Pop:
                     if (!stack_.empty()) {
+                        releaseState(std::move(stack_.back()));
                         stack_.pop_back();
                     }
                     break;
                 case Clear:
-                    stack_.clear();
+                    while (!stack_.empty()) {
+                        releaseState(std::move(stack_.back()));
+                        stack_.pop_back();
+                    }
                     break;
                 }
+                redrawPending_ = true;
             }
             pendingList_.clear();
+
+            // Whatever ends up on top is updated next tick, even if it was frozen until now
+            if (!stack_.empty()) {
+                stack_.back().updated_ = true;
+            }
+            refreshAnimated();
         }
 
         void handleEvent(const sf::Event& event) {
+            redrawPending_ = true;
             for (auto it = stack_.rbegin(); it != stack_.rend(); ++it) {
-                if (!(*it)->handleEvent(event)) {
+                if (!it->state_->handleEvent(event)) {
                     break;
                 }
             }
@@ -597,17 +4699,32 @@ public:
         }
 
         void update(sf::Time dt) {
+            ProfileScope profile("StateStack::update");
+            // Only the states that get updated can change; everything below a blocker is frozen
+            bool reached = true;
             for (auto it = stack_.rbegin(); it != stack_.rend(); ++it) {
-                if (!(*it)->update(dt)) {
-                    break;
+                it->updated_ = reached;
+                if (reached && !it->state_->update(dt)) {
+                    reached = false;
                 }
             }
             applyPendingChanges();
         }
 
-        void draw() {
-            for (const auto& state : stack_) {
-                state->draw();
+        void draw(float interpolation = 1.f) {
+            ProfileScope profile("StateStack::draw");
+            interpolation_ = interpolation;
+            redrawPending_ = false;
+            for (const auto& active : stack_) {
+                active.state_->draw();
+            }
+        }
+
+        void capture(RenderSnapshot& snapshot, float interpolation = 1.f) {
+            ProfileScope profile("StateStack::capture");
+            interpolation_ = interpolation;
+            for (const auto& active : stack_) {
+                active.state_->capture(snapshot);
             }
         }
 
@@ -615,16 +4732,86 @@ public:
             return stack_.empty();
         }
 
+        // False while the last frame drawn is still exactly what would be drawn now
+        bool needsRedraw() const {
+            return redrawPending_ || animated_;
+        }
+
+        void requestRedraw() {
+            redrawPending_ = true;
+        }
+
+        // Shared by every state's draw(); each state draws it before the next one starts
+        RenderQueue& getTextQueue() {
+            return textQueue_;
+        }
+
+        // Fraction of a tick elapsed since the last update, valid during draw and capture
+        float getInterpolation() const {
+            return interpolation_;
+        }
+
     private:
         struct PendingChange {
             Action action;
             States::ID id;
         };
 
-        std::vector<Ptr> stack_;
+        struct ActiveState {
+            Ptr state_;
+            States::ID id_;
+            bool updated_ = true;
+        };
+
+        // Asked again after every update and every stack change, so a state that
+        // stops or starts animating is seen before the next tick
+        void refreshAnimated() {
+            animated_ = std::ranges::any_of(stack_, [](const ActiveState& active) {
+                return active.updated_ && active.state_->isAnimated();
+                });
+        }
+
+        struct Registration {
+            // Runs prepare(), if any, on the calling thread and returns the constructor call
+            std::function<std::function<Ptr()>()> factory_;
+            Lifetime lifetime_ = Rebuilt;
+            Ptr idle_;
+            std::future<Ptr> prewarm_;
+        };
+
+        // A prewarmed state is fresh; only one taken back from idle needs reset()
+        Ptr acquireState(States::ID id) {
+            const auto it = registrations_.find(id);
+            if (it == registrations_.end()) {
+                return nullptr;
+            }
+            Registration& registration = it->second;
+            if (registration.prewarm_.valid()) {
+                return registration.prewarm_.get();
+            }
+            if (registration.idle_) {
+                Ptr state = std::move(registration.idle_);
+                state->reset();
+                return state;
+            }
+            return registration.factory_()();
+        }
+
+        void releaseState(ActiveState&& active) {
+            Registration& registration = registrations_.at(active.id_);
+            if (registration.lifetime_ == Cached && !registration.idle_) {
+                registration.idle_ = std::move(active.state_);
+            }
+        }
+
+        std::vector<ActiveState> stack_;
         std::vector<PendingChange> pendingList_;
         Context context_;
-        std::unordered_map<States::ID, std::function<Ptr()>> factories_;
+        std::unordered_map<States::ID, Registration> registrations_;
+        float interpolation_;
+        bool redrawPending_ = true;
+        bool animated_ = true;
+        RenderQueue textQueue_;
     };
 
 public:
@@ -637,7 +4824,7 @@ public:
         stack_->pushState(id);
     }
 
-    void centerOrigin(sf::Text& text) {
+    void centerOrigin(TextLabel& text) {
         sf::FloatRect bounds = text.getGlobalBounds();
         text.setOrigin({ bounds.size.x / 2.0f, bounds.size.y / 2.0f });
     }
@@ -654,8 +4841,34 @@ public:
         return context_;
     }
 
+    float getInterpolation() const {
+        return stack_->getInterpolation();
+    }
+
+    RenderQueue& getTextQueue() {
+        return stack_->getTextQueue();
+    }
+
+    void requestPrewarm(States::ID id) {
+        stack_->prewarmState(id);
+    }
+
+    // For non-animated states: something changed outside of an input event
+    void requestRedraw() {
+        stack_->requestRedraw();
+    }
+
     virtual ~State() = default;
+    // Called every time the state goes on the stack, whether freshly built or cached
+    virtual void onActivate() {}
+    // Called before a cached state is reused: put it back the way its constructor left it
+    virtual void reset() {}
+    // States that only change in response to input return false; the stack then
+    // redraws them after events and stack changes instead of every frame
+    virtual bool isAnimated() const { return true; }
     virtual void draw() = 0;
+    // Pipelined counterpart of draw(): describe the frame instead of drawing it
+    virtual void capture(RenderSnapshot& snapshot) = 0;
     virtual bool update(sf::Time dt) = 0;
     virtual bool handleEvent(const sf::Event& event) = 0;
 
@@ -668,16 +4881,15 @@ class TitleState : public State {
 public:
     TitleState(State::StateStack& stack, State::Context context)
         : State(stack, context),
-        mBackgroundSprite(context.textures_->get("Textures/Menu.png")),
-        mText(context.fontHolder_->getFont("RobotoMono-Italic-VariableFont_wght")),
+        mBackgroundSprite(context.textures_->get(Textures::Menu)),
+        mText(context.fontHolder_->getFont(Fonts::Main)),
         mShowText(true), mTextEffectTime(sf::Time::Zero) {
 
         mText.setString("Press any key to continue");
         mText.setFillColor(sf::Color::White);
 
         // Center the text on screen
-        sf::FloatRect textBounds = mText.getGlobalBounds();
-        mText.setOrigin({ textBounds.size.x / 2.0f, textBounds.size.y / 2.0f });
+        centerOrigin(mText);
         mText.setPosition({ context.window_->getView().getSize().x / 2.0f,
                           context.window_->getView().getSize().y * 0.8f });
     }
@@ -686,7 +4898,16 @@ public:
         sf::RenderWindow& window = *getContext().window_;
         window.draw(mBackgroundSprite);
         if (mShowText) {
-            window.draw(mText);
+            mText.batch(getTextQueue());
+            getTextQueue().draw(window);
+        }
+    }
+
+    virtual void capture(RenderSnapshot& snapshot) override {
+        RenderQueue& queue = snapshot.beginPass();
+        snapshot.add(mBackgroundSprite);
+        if (mShowText) {
+            mText.batch(queue);
         }
     }
 
@@ -710,7 +4931,7 @@ public:
 
 private:
     sf::Sprite mBackgroundSprite;
-    sf::Text mText;
+    TextLabel mText;
     bool mShowText;
     sf::Time mTextEffectTime;
 };
@@ -721,7 +4942,7 @@ public:
         mOptionIndex = 0;
 
         // Create Play option
-        sf::Text playOption(context.fontHolder_->getFont("RobotoMono-Italic-VariableFont_wght"));
+        TextLabel playOption(context.fontHolder_->getFont(Fonts::Main));
         playOption.setString("Play");
         centerOrigin(playOption);
         playOption.setPosition({ context.window_->getView().getSize().x / 2.f,
@@ -729,7 +4950,7 @@ public:
         mOptions.push_back(playOption);
 
         // Create Exit option
-        sf::Text exitOption(context.fontHolder_->getFont("RobotoMono-Italic-VariableFont_wght"));
+        TextLabel exitOption(context.fontHolder_->getFont(Fonts::Main));
         exitOption.setString("Exit");
         centerOrigin(exitOption);
         exitOption.setPosition({ context.window_->getView().getSize().x / 2.f,
@@ -739,6 +4960,21 @@ public:
         updateOptionText();
     }
 
+    // The game is likely next, so start building it while the menu is up
+    virtual void onActivate() override {
+        getContext().music_->play(Music::MenuTheme);
+        requestPrewarm(States::Game);
+    }
+
+    virtual void reset() override {
+        mOptionIndex = 0;
+        updateOptionText();
+    }
+
+    virtual bool isAnimated() const override {
+        return false;
+    }
+
     virtual bool update(sf::Time dt) override {
         return false;
     }
@@ -746,7 +4982,15 @@ public:
     virtual void draw() override {
         sf::RenderWindow& window = *getContext().window_;
         for (const auto& option : mOptions) {
-            window.draw(option);
+            option.batch(getTextQueue());
+        }
+        getTextQueue().draw(window);
+    }
+
+    virtual void capture(RenderSnapshot& snapshot) override {
+        RenderQueue& queue = snapshot.beginPass();
+        for (const auto& option : mOptions) {
+            option.batch(queue);
         }
     }
 
@@ -795,23 +5039,55 @@ private:
         Play,
         Exit,
     };
-    std::vector<sf::Text> mOptions;
+    std::vector<TextLabel> mOptions;
     std::size_t mOptionIndex;
 };
 
 class GameState : public State {
 public:
-    GameState(State::StateStack& stack, State::Context context)
-        : State(stack, context), world_(*context.window_), player_(*context.player_) {
+    // What the constructor needs from the main thread; it may run on a prewarm worker
+    struct Prepared {
+        sf::Vector2f viewSize_;
+    };
+
+    GameState(State::StateStack& stack, State::Context context, Prepared prepared)
+        : State(stack, context),
+        world_(prepared.viewSize_, *context.textures_, *context.atlas_, *context.jobs_, World::TexturesAcquired{}),
+        renderer_(*context.atlas_),
+        player_(*context.player_) {
+        level_.load(Levels::First);
+        world_.setSpawnSchedule(level_);
+    }
+
+    static Prepared prepare(const Context& context) {
+        World::acquireTextures(*context.textures_, *context.atlas_);
+        return { sf::Vector2f(context.window_->getSize()) };
+    }
+
+    virtual void onActivate() override {
+        getContext().music_->play(Music::MissionTheme);
+    }
+
+    // A new game in the same World: the level restarts but nothing is reloaded
+    virtual void reset() override {
+        world_.reset();
+        world_.setSpawnSchedule(level_);
+    }
+
+    virtual void draw() override {
+        renderer_.draw(world_, *getContext().window_, getInterpolation());
     }
 
-    virtual void draw() override {
-        world_.draw();
+    virtual void capture(RenderSnapshot& snapshot) override {
+        renderer_.capture(world_, snapshot, getInterpolation());
     }
 
     virtual bool update(sf::Time dt) override {
         getContext().player_->handleRealtimeInput(world_.getCommandQueue()); 
         world_.update(dt);
+        for (const SoundEffects::ID sound : world_.getSoundEvents()) {
+            getContext().sounds_->play(sound);
+        }
         return true;
     }
 
@@ -823,6 +5099,10 @@ public:
                 requestPushState(States::Pause);
                 return false; // Don't pass event to player when pausing
             }
+            if (keyPressed->code == sf::Keyboard::Key::F3) {
+                requestPushState(States::Stats);
+                return false;
+            }
         }
 
         player_.handleEvent(event, world_.getCommandQueue());
@@ -831,22 +5111,26 @@ public:
 
 private:
     World world_;
+    WorldRenderer renderer_;
     Player& player_;
+    SpawnSchedule level_;
 };
 
 class PauseState : public State {
 public:
     PauseState(State::StateStack& stack, State::Context context)
         : State(stack, context),
-        mPausedText(context.fontHolder_->getFont("RobotoMono-Italic-VariableFont_wght")),
-        mInstructionText(context.fontHolder_->getFont("RobotoMono-Italic-VariableFont_wght")) {
+        mPausedText(context.fontHolder_->getFont(Fonts::Main)),
+        mInstructionText(context.fontHolder_->getFont(Fonts::Main)) {
+
+        mBackgroundShape.setFillColor(sf::Color(0, 0, 0, 150));
+        mBackgroundShape.setSize(sf::Vector2f(context.window_->getSize()));
 
         // Setup paused text
         mPausedText.setString("Game Paused");
         mPausedText.setFillColor(sf::Color::White);
         mPausedText.setCharacterSize(50);
-        sf::FloatRect pausedBounds = mPausedText.getGlobalBounds();
-        mPausedText.setOrigin({ pausedBounds.size.x / 2.0f, pausedBounds.size.y / 2.0f });
+        centerOrigin(mPausedText);
         mPausedText.setPosition({ context.window_->getView().getSize().x / 2.0f,
                                 context.window_->getView().getSize().y / 2.0f - 50.0f });
 
@@ -854,10 +5138,20 @@ public:
         mInstructionText.setString("Press Backspace to return to menu, Escape to resume");
         mInstructionText.setFillColor(sf::Color::White);
         mInstructionText.setCharacterSize(20);
-        sf::FloatRect instructionBounds = mInstructionText.getGlobalBounds();
-        mInstructionText.setOrigin({ instructionBounds.size.x / 2.0f, instructionBounds.size.y / 2.0f });
+        centerOrigin(mInstructionText);
         mInstructionText.setPosition({ context.window_->getView().getSize().x / 2.0f,
                                      context.window_->getView().getSize().y / 2.0f + 50.0f });
+
+        context.music_->setPaused(true);
+    }
+
+    ~PauseState() override {
+        getContext().music_->setPaused(false);
+    }
+
+    // The world below is frozen too, so a paused screen is only redrawn on input
+    virtual bool isAnimated() const override {
+        return false;
     }
 
     virtual void draw() override {
@@ -865,14 +5159,19 @@ public:
         window.setView(window.getDefaultView());
 
         // Draw semi-transparent background
-        sf::RectangleShape backgroundShape;
-        backgroundShape.setFillColor(sf::Color(0, 0, 0, 150));
-        backgroundShape.setSize(sf::Vector2f(window.getSize()));
-        window.draw(backgroundShape);
+        window.draw(mBackgroundShape);
 
         // Draw text
-        window.draw(mPausedText);
-        window.draw(mInstructionText);
+        mPausedText.batch(getTextQueue());
+        mInstructionText.batch(getTextQueue());
+        getTextQueue().draw(window);
+    }
+
+    virtual void capture(RenderSnapshot& snapshot) override {
+        RenderQueue& queue = snapshot.beginPass();
+        snapshot.add(mBackgroundShape);
+        mPausedText.batch(queue);
+        mInstructionText.batch(queue);
     }
 
     virtual bool update(sf::Time dt) override {
@@ -894,54 +5193,377 @@ public:
     }
 
 private:
-    sf::Text mPausedText;
-    sf::Text mInstructionText;
+    sf::RectangleShape mBackgroundShape;
+    TextLabel mPausedText;
+    TextLabel mInstructionText;
+};
+
+// Profiler overlay pushed over the game with F3. Lets everything below it
+// update and handle input; F3 again closes it, F4 starts/stops a trace capture.
+class StatsState : public State {
+public:
+    StatsState(State::StateStack& stack, State::Context context)
+        : State(stack, context),
+        text_(context.fontHolder_->getFont(Fonts::Main), "", 16),
+        refreshTime_(refreshInterval_) {
+
+        text_.setFillColor(sf::Color::White);
+        text_.setPosition({ 10.f, 10.f });
+        background_.setFillColor(sf::Color(0, 0, 0, 160));
+        background_.setPosition({ 0.f, 0.f });
+        background_.setSize({ 420.f, 0.f });
+    }
+
+    virtual void draw() override {
+        sf::RenderWindow& window = *getContext().window_;
+        window.setView(window.getDefaultView());
+        window.draw(background_);
+        text_.batch(getTextQueue());
+        getTextQueue().draw(window);
+    }
+
+    virtual void capture(RenderSnapshot& snapshot) override {
+        RenderQueue& queue = snapshot.beginPass();
+        snapshot.add(background_);
+        text_.batch(queue);
+    }
+
+    virtual bool update(sf::Time dt) override {
+        // Text is rebuilt a few times a second, not every frame
+        refreshTime_ += dt;
+        if (refreshTime_ >= refreshInterval_) {
+            refreshTime_ = sf::Time::Zero;
+            refreshText();
+        }
+        return true;
+    }
+
+    virtual bool handleEvent(const sf::Event& event) override {
+        if (const auto* keyPressed = event.getIf<sf::Event::KeyPressed>()) {
+            if (keyPressed->code == sf::Keyboard::Key::F3) {
+                requestPopState();
+                return false;
+            }
+            if (keyPressed->code == sf::Keyboard::Key::F4) {
+                Profiler& profiler = Profiler::instance();
+                if (!profiler.isCapturing()) {
+                    profiler.startCapture();
+                }
+                else if (!profiler.stopCapture("trace.json")) {
+                    std::cerr << "Can't write trace.json\n";
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr sf::Time refreshInterval_ = sf::milliseconds(250);
+
+    void refreshText() {
+        const Profiler& profiler = Profiler::instance();
+        const Profiler::FrameStats stats = profiler.getFrameStats();
+
+        buffer_.str({});
+        buffer_ << std::fixed << std::setprecision(2)
+            << "FPS " << stats.fps_ << "\n"
+            << "frame p50/p95/p99 " << stats.p50Ms_ << " / " << stats.p95Ms_ << " / " << stats.p99Ms_ << " ms\n"
+            << "draw calls " << profiler.getCounter(Profiler::DrawCalls)
+            << "  nodes " << profiler.getCounter(Profiler::Nodes)
+            << "  particles " << profiler.getCounter(Profiler::Particles)
+            << "  commands " << profiler.getCounter(Profiler::CommandQueueDepth) << "\n";
+
+        if (!AllocationCounter::enabled) {
+            buffer_ << "allocations not tracked\n";
+        }
+        else {
+            const AllocationCounter::Usage allocations = AllocationCounter::getLastFrameTotal();
+            buffer_ << "allocations " << allocations.allocations_ << " (" << allocations.bytes_ << " B)\n";
+            for (std::size_t i = AllocationCounter::Untagged + 1; i < AllocationCounter::TagCount; ++i) {
+                const auto tag = static_cast<AllocationCounter::Tag>(i);
+                const AllocationCounter::Usage usage = AllocationCounter::getLastFrame(tag);
+                buffer_ << "  " << AllocationCounter::getName(tag) << " " << usage.allocations_;
+                if (AllocationCounter::getBudget(tag) != AllocationCounter::unlimited) {
+                    buffer_ << " / " << AllocationCounter::getBudget(tag);
+                }
+                if (const std::uint64_t over = AllocationCounter::getOverBudgetFrames(tag)) {
+                    buffer_ << "  over budget in " << over << " frames";
+                }
+                buffer_ << "\n";
+            }
+        }
+        for (const auto& zone : profiler.getLastFrameZones()) {
+            buffer_ << zone.name_ << " " << static_cast<float>(zone.micros_) / 1000.f << " ms\n";
+        }
+        if (profiler.isCapturing()) {
+            buffer_ << "capturing trace (F4 to save)\n";
+        }
+
+        text_.setString(buffer_.str());
+        background_.setSize({ background_.getSize().x, text_.getGlobalBounds().size.y + 30.f });
+    }
+
+    TextLabel text_;
+    sf::RectangleShape background_;
+    sf::Time refreshTime_;
+    std::ostringstream buffer_;
 };
 
+// Decodes images, fonts and sound buffers on worker threads. Results are handed
+// back to the main thread through uploadPending(); images, which need the GL
+// context, are uploaded in slices so a large texture never stalls a whole frame.
 class ParallelTask {
 public:
-    ParallelTask() : finished_(false) {}
+    explicit ParallelTask(unsigned int workerCount = std::clamp(std::thread::hardware_concurrency(), 1u, 4u))
+        : workerCount_(std::max(workerCount, 1u)),
+        totalBytes_(0),
+        decodedBytes_(0),
+        uploadedBytes_(0),
+        pendingJobs_(0) {
+    }
+
+    ~ParallelTask() {
+        for (auto& worker : workers_) {
+            worker.request_stop();
+        }
+        jobsAvailable_.notify_all();
+    }
+
+    ParallelTask(const ParallelTask&) = delete;
+    ParallelTask& operator=(const ParallelTask&) = delete;
+
+    void addTexture(Textures::ID id) {
+        addJob(Job::Texture, id, Assets::getPath(id));
+    }
+
+    void addAtlasImage(Textures::ID id) {
+        addJob(Job::AtlasImage, id, Assets::getPath(id));
+    }
+
+    void addFont(Fonts::ID id) {
+        addJob(Job::Font, id, Assets::getPath(id));
+    }
+
+    // Audio is optional: a sound that fails to decode is reported and skipped
+    void addSound(SoundEffects::ID id) {
+        addJob(Job::Sound, id, Assets::getPath(id));
+    }
 
     void execute() {
-        clock_.restart();
-        thread_ = std::jthread([this](std::stop_token stoken) {
-            runTask(stoken);
-            });
+        for (unsigned int i = 0; i < workerCount_; ++i) {
+            workers_.emplace_back([this](std::stop_token stoken) {
+                runTask(stoken);
+                });
+        }
     }
 
-    ~ParallelTask() {
-        if (thread_.joinable()) {
-            thread_.request_stop();
+    // Main thread only: moves up to byteBudget bytes of decoded pixels to the GPU
+    void uploadPending(TextureHolder& textures, TextureAtlas& atlas, FontHolder& fonts, SoundPlayer& sounds,
+        std::size_t byteBudget) {
+        while (byteBudget > 0) {
+            if (!upload_) {
+                std::optional<Result> result = popResult();
+                if (!result) {
+                    break;
+                }
+                if (!result->error_.empty()) {
+                    if (result->type_ != Job::Sound) {
+                        throw std::runtime_error(result->error_);
+                    }
+                    std::cerr << result->error_ << " (sound disabled)\n";
+                    continue;
+                }
+                if (result->type_ == Job::Font) {
+                    // Nothing draws with it yet, so its pages can be filled on this thread
+                    TextLabel::prerasterize(*result->font_);
+                    fonts.insert(static_cast<Fonts::ID>(result->id_), std::move(result->font_));
+                    continue;
+                }
+                if (result->type_ == Job::Sound) {
+                    sounds.insert(static_cast<SoundEffects::ID>(result->id_), std::move(result->sound_));
+                    continue;
+                }
+                if (result->type_ == Job::AtlasImage) {
+                    atlas.add(static_cast<Textures::ID>(result->id_), result->image_);
+                    uploadedBytes_ += result->fileBytes_;
+                    continue;
+                }
+                upload_ = std::move(result);
+                upload_->texture_ = std::make_unique<sf::Texture>();
+                if (!upload_->texture_->resize(upload_->image_.getSize())) {
+                    throw std::runtime_error("Can't create texture for: " + upload_->path_.string());
+                }
+            }
+
+            const sf::Vector2u size = upload_->image_.getSize();
+            const std::size_t rowBytes = static_cast<std::size_t>(size.x) * 4;
+            const unsigned int rows = std::min(
+                static_cast<unsigned int>(std::max<std::size_t>(byteBudget / rowBytes, 1)),
+                size.y - upload_->uploadedRows_);
+
+            upload_->texture_->update(upload_->image_.getPixelsPtr() + upload_->uploadedRows_ * rowBytes,
+                { size.x, rows }, { 0u, upload_->uploadedRows_ });
+            upload_->uploadedRows_ += rows;
+            byteBudget -= std::min(byteBudget, rows * rowBytes);
+
+            const std::uintmax_t uploaded = upload_->fileBytes_ * upload_->uploadedRows_ / size.y;
+            uploadedBytes_ += uploaded - upload_->reportedBytes_;
+            upload_->reportedBytes_ = uploaded;
+
+            if (upload_->uploadedRows_ == size.y) {
+                textures.insert(static_cast<Textures::ID>(upload_->id_), std::move(upload_->texture_));
+                upload_.reset();
+            }
+        }
+
+        // Atlas pages are uploaded whole, once everything has been packed
+        if (taskFinished()) {
+            atlas.upload();
         }
     }
 
+    // Decoding and uploading each count for half of a texture's file size; fonts
+    // and sounds are done once decoded
     float getCompletion() const {
         std::lock_guard<std::mutex> lk(mtx_);
-        return std::min(clock_.getElapsedTime().asSeconds() / 3.f, 1.0f); 
+        if (totalBytes_ == 0) {
+            return 1.f;
+        }
+        return static_cast<float>(decodedBytes_ + uploadedBytes_) / static_cast<float>(totalBytes_);
     }
 
     bool taskFinished() const {
         std::lock_guard<std::mutex> lk(mtx_);
-        return finished_.load();
+        return pendingJobs_ == 0 && results_.empty() && !upload_;
     }
 
 private:
+    struct Job {
+        enum Type {
+            Texture,
+            AtlasImage,
+            Font,
+            Sound
+        };
+
+        Type type_;
+        std::size_t id_;
+        std::filesystem::path path_;
+        std::uintmax_t fileBytes_;
+    };
+
+    struct Result {
+        std::size_t id_ = 0;
+        std::filesystem::path path_;
+        std::string error_;
+        std::uintmax_t fileBytes_ = 0;
+        Job::Type type_ = Job::Texture;
+        sf::Image image_;
+        std::unique_ptr<sf::Font> font_;
+        std::unique_ptr<sf::SoundBuffer> sound_;
+        std::unique_ptr<sf::Texture> texture_;
+        unsigned int uploadedRows_ = 0;
+        std::uintmax_t reportedBytes_ = 0;
+    };
+
+    // Bytes in the mounted pack, if the asset is in there
+    static std::span<const std::byte> findPacked(Job::Type type, std::size_t id) {
+        const AssetPack& pack = AssetPack::instance();
+        switch (type) {
+        case Job::Font:
+            return pack.find(static_cast<Fonts::ID>(id));
+        case Job::Sound:
+            return pack.find(static_cast<SoundEffects::ID>(id));
+        default:
+            return pack.find(static_cast<Textures::ID>(id));
+        }
+    }
+
+    void addJob(Job::Type type, std::size_t id, const std::filesystem::path& path) {
+        std::error_code ec;
+        const std::span<const std::byte> packed = findPacked(type, id);
+        std::uintmax_t bytes = packed.empty() ? std::filesystem::file_size(path, ec) : packed.size();
+        if (ec) {
+            bytes = 1;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            jobs_.push_back({ type, id, path, bytes });
+            totalBytes_ += bytes;
+            ++pendingJobs_;
+        }
+        jobsAvailable_.notify_one();
+    }
+
+    std::optional<Result> popResult() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (results_.empty()) {
+            return std::nullopt;
+        }
+        Result result = std::move(results_.front());
+        results_.pop_front();
+        return result;
+    }
+
     void runTask(std::stop_token stoken) {
         while (!stoken.stop_requested()) {
-            std::lock_guard<std::mutex> lk(mtx_);
-            if (clock_.getElapsedTime().asSeconds() >= 3.f) {
-                finished_ = true;
-                break;
+            Job job;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                if (!jobsAvailable_.wait(lk, stoken, [this] { return !jobs_.empty(); })) {
+                    return;
+                }
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+
+            Result result;
+            result.id_ = job.id_;
+            result.path_ = job.path_;
+            result.fileBytes_ = job.fileBytes_;
+            result.type_ = job.type_;
+            std::uintmax_t decoded = job.fileBytes_;
+
+            const std::span<const std::byte> packed = findPacked(job.type_, job.id_);
+            if (job.type_ == Job::Font) {
+                result.font_ = std::make_unique<sf::Font>();
+                if (packed.empty() ? !result.font_->openFromFile(job.path_) : !result.font_->openFromMemory(packed.data(), packed.size())) {
+                    result.error_ = "Font failed to load: " + job.path_.string();
+                }
+            }
+            else if (job.type_ == Job::Sound) {
+                result.sound_ = std::make_unique<sf::SoundBuffer>();
+                if (packed.empty() ? !result.sound_->loadFromFile(job.path_) : !result.sound_->loadFromMemory(packed.data(), packed.size())) {
+                    result.error_ = "Can't load resource from file: " + job.path_.string();
+                }
+            }
+            else {
+                if (packed.empty() ? !result.image_.loadFromFile(job.path_) : !result.image_.loadFromMemory(packed.data(), packed.size())) {
+                    result.error_ = "Can't load resource from file: " + job.path_.string();
+                }
+                decoded = job.fileBytes_ / 2;
+                result.fileBytes_ = job.fileBytes_ - decoded; // the rest is reported while uploading
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            std::lock_guard<std::mutex> lk(mtx_);
+            decodedBytes_ += decoded;
+            --pendingJobs_;
+            results_.push_back(std::move(result));
         }
     }
 
-private:
-    std::jthread thread_;
+    unsigned int workerCount_;
     mutable std::mutex mtx_;
-    std::atomic<bool> finished_;
-    sf::Clock clock_;
+    std::condition_variable_any jobsAvailable_;
+    std::deque<Job> jobs_;
+    std::deque<Result> results_;
+    std::optional<Result> upload_;
+    std::uintmax_t totalBytes_;
+    std::uintmax_t decodedBytes_;
+    std::uintmax_t uploadedBytes_;
+    std::size_t pendingJobs_;
+    std::vector<std::jthread> workers_;
 };
 
 class LoadingState : public State {
@@ -949,7 +5571,7 @@ public:
     LoadingState(StateStack& stack, State::Context context)
         : State(stack, context),
         window_(*context.window_),
-        loadingText_(context.fontHolder_->getFont("RobotoMono-Italic-VariableFont_wght")) {
+        loadingText_(context.fontHolder_->getFont(Fonts::Main)) {
 
         loadingText_.setString("Loading Resources...");
         centerOrigin(loadingText_);
@@ -970,17 +5592,44 @@ public:
         progressBar_.setPosition(progressBarBackground_.getPosition());
 
         setCompletion(0.f);
-        loadingTask_.execute(); 
+        for (const Textures::ID id : World::getTextures()) {
+            loadingTask_.addTexture(id);
+        }
+        for (const Textures::ID id : World::getSprites()) {
+            loadingTask_.addAtlasImage(id);
+        }
+        for (std::size_t i = 0; i < Fonts::Count; ++i) {
+            if (!context.fontHolder_->isLoaded(static_cast<Fonts::ID>(i))) {
+                loadingTask_.addFont(static_cast<Fonts::ID>(i));
+            }
+        }
+        for (std::size_t i = 0; i < SoundEffects::Count; ++i) {
+            if (!context.sounds_->isLoaded(static_cast<SoundEffects::ID>(i))) {
+                loadingTask_.addSound(static_cast<SoundEffects::ID>(i));
+            }
+        }
+        loadingTask_.execute();
     }
 
     virtual void draw() override {
         window_.clear(sf::Color::Black);
-        window_.draw(loadingText_);
         window_.draw(progressBarBackground_);
         window_.draw(progressBar_);
+        loadingText_.batch(getTextQueue());
+        getTextQueue().draw(window_);
+    }
+
+    virtual void capture(RenderSnapshot& snapshot) override {
+        RenderQueue& queue = snapshot.beginPass();
+        snapshot.add(progressBarBackground_);
+        snapshot.add(progressBar_);
+        loadingText_.batch(queue);
     }
 
     virtual bool update(sf::Time dt) override {
+        loadingTask_.uploadPending(*getContext().textures_, *getContext().atlas_, *getContext().fontHolder_,
+            *getContext().sounds_, uploadBytesPerFrame_);
+
         if (loadingTask_.taskFinished()) {
             requestPopState();
             requestPushState(States::Menu);
@@ -1001,8 +5650,10 @@ private:
         progressBar_.setSize({ progressBarBackground_.getSize().x * percent, 10.f });
     }
 
+    static constexpr std::size_t uploadBytesPerFrame_ = 4 * 1024 * 1024;
+
     sf::RenderWindow& window_;
-    sf::Text loadingText_;
+    TextLabel loadingText_;
     sf::RectangleShape progressBarBackground_;
     sf::RectangleShape progressBar_;
     ParallelTask loadingTask_;
@@ -1018,21 +5669,39 @@ public:
     }
 
     void processEvents() {
+        ProfileScope profile("Application::processEvents");
         while (std::optional<sf::Event> event = window_.pollEvent()) {
-            stateStack_.handleEvent(*event);
+            handleEvent(*event);
         }
     }
 
+    void handleEvent(const sf::Event& event) {
+        stateStack_.handleEvent(event);
+    }
+
     void update(sf::Time dt) {
         stateStack_.update(dt);
     }
 
-    void render() {
+    void render(float interpolation = 1.f) {
         window_.clear();
-        stateStack_.draw();
+        stateStack_.draw(interpolation);
+        ProfileScope profile("RenderWindow::display");
         window_.display();
     }
 
+    void capture(RenderSnapshot& snapshot, float interpolation = 1.f) {
+        stateStack_.capture(snapshot, interpolation);
+    }
+
+    bool isFinished() const {
+        return stateStack_.isEmpty();
+    }
+
+    bool needsRedraw() const {
+        return stateStack_.needsRedraw();
+    }
+
     void run() {
         processEvents();
         render();
@@ -1044,9 +5713,10 @@ private:
     void registerStates() {
         stateStack_.registerState<TitleState>(States::Title);
         stateStack_.registerState<LoadingState>(States::Loading); 
-        stateStack_.registerState<MenuState>(States::Menu);
-        stateStack_.registerState<GameState>(States::Game);
+        stateStack_.registerState<MenuState>(States::Menu, State::StateStack::Cached);
+        stateStack_.registerState<GameState>(States::Game, State::StateStack::Cached);
         stateStack_.registerState<PauseState>(States::Pause);
+        stateStack_.registerState<StatsState>(States::Stats);
     }
 
 
@@ -1056,35 +5726,458 @@ private:
 
 class StatefulGame {
 public:
-    StatefulGame()
+    explicit StatefulGame(unsigned int ticksPerSecond = 60, unsigned int maxStepsPerFrame = 5)
         : window_(sf::VideoMode({ 1920u, 1080u }), "SFML Game"),
-        context_(window_, textureHolder_, fontHolder_, player_),
-        app_(window_, context_) {
+        context_(window_, textureHolder_, atlas_, fontHolder_, player_, soundPlayer_, musicPlayer_, jobs_),
+        app_(window_, context_),
+        timestep_(ticksPerSecond, maxStepsPerFrame) {
+        pacer_.apply(window_);
+    }
+
+    Player& getPlayer() {
+        return player_;
+    }
+
+    void setFramePacing(const FramePacer& pacer) {
+        pacer_ = pacer;
+        pacer_.apply(window_);
     }
 
     void run() {
         sf::Clock clock;
         while (window_.isOpen()) {
-            sf::Time dt = clock.restart();
+            Profiler::instance().beginFrame();
+            timestep_.advance(clock.restart());
             app_.processEvents();
-            app_.update(dt);
-            app_.render();
+            while (timestep_.step()) {
+                app_.update(timestep_.getTimePerTick());
+            }
+            if (app_.isFinished()) {
+                window_.close();
+                break;
+            }
+            const bool redraw = app_.needsRedraw();
+            if (redraw) {
+                app_.render(timestep_.getInterpolation());
+            }
+            pacer_.endFrame(redraw);
+        }
+    }
+
+    // Runs the states on a simulation thread that stays one frame ahead of this
+    // one. This thread keeps the window: it polls events, forwards them, and
+    // draws whichever snapshot the simulation finished last. Every frame is
+    // presented here (the simulation paces itself on the free snapshot), so
+    // only the pacing policy applies, not needsRedraw().
+    void runPipelined() {
+        // Layout runs on the simulation thread; with every page filled in here
+        // it only reads glyphs while this thread binds the page textures
+        // (fonts the loading screen decodes later are filled in as they arrive).
+        for (std::size_t id = 0; id < Fonts::Count; ++id) {
+            if (fontHolder_.isLoaded(static_cast<Fonts::ID>(id))) {
+                TextLabel::prerasterize(fontHolder_.getFont(static_cast<Fonts::ID>(id)));
+            }
+        }
+
+        FramePipeline pipeline;
+        std::jthread simulation([this, &pipeline](std::stop_token stop) {
+            simulate(stop, pipeline);
+            });
+
+        while (window_.isOpen()) {
+            while (std::optional<sf::Event> event = window_.pollEvent()) {
+                if (event->is<sf::Event::Closed>()) {
+                    window_.close();
+                }
+                std::scoped_lock lock(eventMutex_);
+                events_.push_back(*event);
+            }
+            if (!window_.isOpen()) {
+                break;
+            }
+
+            RenderSnapshot* snapshot = pipeline.beginDraw();
+            if (!snapshot) {
+                break;
+            }
+            window_.clear();
+            snapshot->draw(window_);
+            {
+                ProfileScope profile("RenderWindow::display");
+                window_.display();
+            }
+            pipeline.endDraw();
+            pacer_.endFrame(true);
         }
+
+        simulation.request_stop();
+        simulation.join();
+        window_.close();
     }
 
 private:
+    // Texture and font uploads from the loading screen still happen here, on
+    // SFML's per-thread shared context; nothing they touch is on screen yet.
+    void simulate(std::stop_token stop, FramePipeline& pipeline) {
+        std::vector<sf::Event> events;
+        sf::Clock clock;
+        while (!stop.stop_requested()) {
+            Profiler::instance().beginFrame();
+            {
+                std::scoped_lock lock(eventMutex_);
+                events.swap(events_);
+            }
+            for (const sf::Event& event : events) {
+                app_.handleEvent(event);
+            }
+            events.clear();
+
+            timestep_.advance(clock.restart());
+            while (timestep_.step()) {
+                app_.update(timestep_.getTimePerTick());
+            }
+            if (app_.isFinished()) {
+                break;
+            }
+
+            RenderSnapshot* snapshot = pipeline.beginCapture(stop);
+            if (!snapshot) {
+                break;
+            }
+            app_.capture(*snapshot, timestep_.getInterpolation());
+            pipeline.endCapture();
+        }
+        pipeline.finish();
+    }
+
     sf::RenderWindow window_;
     TextureHolder textureHolder_;
+    TextureAtlas atlas_;
     FontHolder fontHolder_;
     Player player_;
+    SoundPlayer soundPlayer_;
+    MusicPlayer musicPlayer_;
+    JobSystem jobs_;
     State::Context context_;
     Application app_;
+    FixedTimestep timestep_;
+    FramePacer pacer_;
+    std::mutex eventMutex_;
+    std::vector<sf::Event> events_;
 };
 
-int main() {
+// Hammers JobSystem::parallelFor with random range and grain sizes on pools of
+// every size up to the hardware's, checking each index runs exactly once. Each
+// chunk writes its indices without synchronisation and the caller reads them
+// after parallelFor() returns, so building with -fsanitize=thread also checks
+// that completion publishes the workers' writes. Returns false on any miss.
+bool runJobStressTest(unsigned int rounds) {
+    std::minstd_rand rng(42);
+    std::uniform_int_distribution<std::size_t> countDistribution(0, 100000);
+    std::uniform_int_distribution<std::size_t> grainDistribution(1, 4096);
+    std::vector<std::uint8_t> visits;
+    std::size_t failures = 0;
+
+    const unsigned int maxWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    for (unsigned int workers = 1; workers <= maxWorkers; ++workers) {
+        JobSystem jobs(workers);
+        for (unsigned int round = 0; round < rounds; ++round) {
+            const std::size_t count = countDistribution(rng);
+            const std::size_t grain = grainDistribution(rng);
+            visits.assign(count, 0);
+            std::atomic<bool> outOfRange = false;
+            jobs.parallelFor(count, grain, [&](std::size_t begin, std::size_t end) {
+                if (begin >= end || end > count || end - begin > grain) {
+                    outOfRange.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                for (std::size_t i = begin; i < end; ++i) {
+                    ++visits[i];
+                }
+                });
+            if (outOfRange.load() || std::ranges::any_of(visits, [](std::uint8_t visited) { return visited != 1; })) {
+                std::cerr << "parallelFor(" << count << ", " << grain << ") on " << workers + 1
+                    << " threads did not run every index exactly once\n";
+                ++failures;
+            }
+        }
+    }
+
+    std::cout << "JobSystem, " << rounds << " rounds on 2 to " << maxWorkers + 1 << " threads: "
+        << (failures == 0 ? "ok" : std::to_string(failures) + " failed") << "\n";
+    return failures == 0;
+}
+
+// Compares the batch Kinematics kernel against integrating the same number of Entity nodes
+void runKinematicsBenchmark(std::size_t count, unsigned int ticks) {
+    const sf::Time dt = sf::seconds(1.f / 60.f);
+    const sf::FloatRect bounds({ 0.f, 0.f }, { 1920.f, 2000.f });
+
+    NodePool pool;
+    SceneNode root;
+    for (std::size_t i = 0; i < count; ++i) {
+        auto entity = pool.make<Entity>();
+        entity->setPosition({ static_cast<float>(i % 1920), static_cast<float>(i % 2000) });
+        entity->setVelocity(static_cast<float>(i % 7) - 3.f, static_cast<float>(i % 11) - 5.f);
+        root.addChild(std::move(entity));
+    }
+
+    std::vector<float> x(count), y(count), vx(count), vy(count);
+    std::vector<std::uint8_t> outside(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        x[i] = static_cast<float>(i % 1920);
+        y[i] = static_cast<float>(i % 2000);
+        vx[i] = static_cast<float>(i % 7) - 3.f;
+        vy[i] = static_cast<float>(i % 11) - 5.f;
+    }
+
+    sf::Clock clock;
+    for (unsigned int tick = 0; tick < ticks; ++tick) {
+        root.update(dt);
+    }
+    const sf::Time nodeTime = clock.restart();
+
+    JobSystem jobs;
+    root.setParallelUpdate(&jobs);
+    clock.restart();
+    for (unsigned int tick = 0; tick < ticks; ++tick) {
+        root.update(dt);
+    }
+    const sf::Time parallelTime = clock.restart();
+
+    std::size_t leaving = 0;
+    for (unsigned int tick = 0; tick < ticks; ++tick) {
+        leaving += Kinematics::step(x.data(), y.data(), vx.data(), vy.data(), outside.data(),
+            count, dt.asSeconds(), &bounds, bounds);
+    }
+    const sf::Time kernelTime = clock.restart();
+
+    std::cout << "Kinematics, " << count << " entities x " << ticks << " ticks\n"
+        << "  SceneNode::update: " << nodeTime.asMicroseconds() / ticks << " us/tick\n"
+        << "  parallel update:   " << parallelTime.asMicroseconds() / ticks << " us/tick"
+        << " (" << jobs.getWorkerCount() + 1 << " threads)\n"
+        << "  Kinematics::step:  " << kernelTime.asMicroseconds() / ticks << " us/tick"
+        << " (" << Kinematics::simdPath << ", " << leaving << " outside)\n";
+}
+
+// Steps a headless World with scripted input at a fixed dt. With render set it
+// also draws every tick into an offscreen sf::RenderTexture. A replay, if given,
+// replaces the scripted input. Particles are topped up to particleCount every
+// tick, around the camera, as a stand-in for sustained fire and explosions.
+// After a warm-up second every tick is held to the allocation budgets; returns
+// false if any tag went over.
+bool runWorldBenchmark(std::size_t entityCount, std::size_t particleCount, unsigned int ticks, bool render,
+    InputReplay* replay = nullptr) {
+    const sf::Time dt = sf::seconds(1.f / 60.f);
+    const sf::Vector2f viewSize(1920.f, 1080.f);
+
+    // Placeholder art so no asset files (or GPU, unless rendering) are needed
+    TextureHolder textures;
+    TextureAtlas atlas;
+    for (const Textures::ID id : World::getTextures()) {
+        textures.insert(id, std::make_unique<sf::Texture>());
+    }
+    for (const Textures::ID id : World::getSprites()) {
+        atlas.add(id, sf::Image({ 64u, 64u }, sf::Color::White));
+    }
+
+    JobSystem jobs;
+    World world(viewSize, textures, atlas, jobs);
+    const TextureRegion& sprite = atlas.get(Textures::Raptor);
+    EntityStore& entities = world.getEntities();
+    entities.reserve(entityCount);
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> x(0.f, 1920.f), y(0.f, 2000.f), speed(-20.f, 20.f);
+    for (std::size_t i = 0; i < entityCount; ++i) {
+        entities.create({ x(rng), y(rng) }, { speed(rng), speed(rng) }, Category::EnemyAircraft, sprite);
+    }
+
+    ParticleSystem& particles = world.getParticles();
+    particleCount = std::min(particleCount, particles.getCapacity());
+    std::uniform_real_distribution<float> spread(-0.5f, 0.5f), sparkSpeed(-200.f, 200.f), sparkLife(0.5f, 2.f);
+
+    std::optional<sf::RenderTexture> target;
+    std::optional<WorldRenderer> renderer;
+    if (render) {
+        target.emplace(sf::Vector2u(viewSize));
+        renderer.emplace(atlas);
+    }
+
+    // Circle the player: a quarter second in each direction
+    static constexpr std::array<sf::Vector2f, 4> directions = { {
+        { -1.f, 0.f }, { 0.f, -1.f }, { 1.f, 0.f }, { 0.f, 1.f },
+    } };
+
+    Player player;
+    player.setReplay(replay);
+
+    std::vector<std::int64_t> tickTimes(ticks);
+    const std::uint64_t allocationsBefore = AllocationCounter::allocations_.load();
+    const unsigned int warmupTicks = std::min(ticks / 2, 60u);
+    std::array<std::uint64_t, AllocationCounter::TagCount> peakAllocations{};
+    sf::Clock total;
+
+    for (unsigned int tick = 0; tick < ticks; ++tick) {
+        sf::Clock clock;
+        AllocationCounter::beginFrame();
+        if (tick == warmupTicks) {
+            AllocationCounter::resetOverBudgetFrames();
+            peakAllocations.fill(0);
+        }
+        for (std::size_t tag = 0; tag < AllocationCounter::TagCount; ++tag) {
+            peakAllocations[tag] = std::max(peakAllocations[tag],
+                AllocationCounter::getLastFrame(static_cast<AllocationCounter::Tag>(tag)).allocations_);
+        }
+
+        if (replay) {
+            player.handleRealtimeInput(world.getCommandQueue());
+        }
+        else {
+            Command command;
+            command.category_ = Category::PlayerAircraft;
+            command.action_ = [direction = directions[(tick / 15) % directions.size()]](SceneNode& node, sf::Time step) {
+                node.move(direction * (200.f * step.asSeconds()));
+                };
+            world.getCommandQueue().emplace(std::move(command));
+        }
+        const sf::Vector2f center = world.getInterpolatedView(1.f).getCenter();
+        while (particles.size() < particleCount) {
+            particles.emit(center + sf::Vector2f(spread(rng) * viewSize.x, spread(rng) * viewSize.y),
+                { sparkSpeed(rng), sparkSpeed(rng) }, sf::seconds(sparkLife(rng)), sf::Color(255, 150, 40), 4.f);
+        }
+        world.update(dt);
+
+        if (render) {
+            target->clear();
+            renderer->draw(world, *target);
+            target->display();
+        }
+        tickTimes[tick] = clock.getElapsedTime().asMicroseconds();
+    }
+
+    const sf::Time elapsed = total.getElapsedTime();
+    const std::uint64_t allocations = AllocationCounter::allocations_.load() - allocationsBefore;
+
+    std::sort(tickTimes.begin(), tickTimes.end());
+    const std::int64_t p99 = tickTimes.empty() ? 0 : tickTimes[std::min(tickTimes.size() - 1, tickTimes.size() * 99 / 100)];
+
+    std::cout << "World, " << entityCount << " entities, " << particleCount << " particles x " << ticks << " ticks"
+        << (render ? " (rendered)" : "") << "\n"
+        << "  ticks/sec:        " << static_cast<float>(ticks) / elapsed.asSeconds() << "\n"
+        << "  p99 tick:         " << p99 << " us\n"
+        << "  entities left:    " << entities.size() << "\n"
+        << "  particles live:   " << particles.size() << "\n";
+
+    if (!AllocationCounter::enabled) {
+        std::cout << "  allocations/tick: not tracked (build with SPACESHOOTER_TRACK_ALLOCS)\n";
+        return true;
+    }
+    std::cout << "  allocations/tick: " << static_cast<float>(allocations) / static_cast<float>(std::max(ticks, 1u)) << "\n";
+
+    // The last tick is still open; close it so it is checked too
+    AllocationCounter::beginFrame();
+    bool withinBudget = true;
+    std::cout << "  peak allocations/tick after warm-up:\n";
+    for (std::size_t i = 0; i < AllocationCounter::TagCount; ++i) {
+        const auto tag = static_cast<AllocationCounter::Tag>(i);
+        const std::uint64_t peak = std::max(peakAllocations[tag], AllocationCounter::getLastFrame(tag).allocations_);
+        std::cout << "    " << std::left << std::setw(16) << AllocationCounter::getName(tag) << std::right << peak;
+        if (AllocationCounter::getBudget(tag) != AllocationCounter::unlimited) {
+            std::cout << " / " << AllocationCounter::getBudget(tag);
+        }
+        if (const std::uint64_t over = AllocationCounter::getOverBudgetFrames(tag)) {
+            std::cout << "  OVER BUDGET in " << over << " ticks";
+            withinBudget = false;
+        }
+        std::cout << "\n";
+    }
+    return withinBudget;
+}
+
+int main(int argc, char* argv[]) {
     try {
-        StatefulGame game;
-        game.run();
+        const std::vector<std::string_view> args(argv + 1, argv + argc);
+        auto isNumber = [&args](std::size_t i) {
+            return i < args.size() && !args[i].empty() && std::isdigit(static_cast<unsigned char>(args[i][0]));
+            };
+        auto option = [&args](std::string_view name) -> std::optional<std::string> {
+            const auto it = std::ranges::find(args, name);
+            if (it == args.end()) {
+                return std::nullopt;
+            }
+            if (std::next(it) == args.end()) {
+                throw std::runtime_error("Missing value for " + std::string(name));
+            }
+            return std::string(*std::next(it));
+            };
+
+        if (!args.empty() && args[0] == "--pack") {
+            if (args.size() < 2) {
+                throw std::runtime_error("Usage: --pack <output> [asset root]");
+            }
+            AssetPack::write(std::string(args[1]), args.size() > 2 ? std::filesystem::path(std::string(args[2])) : ".");
+            return EXIT_SUCCESS;
+        }
+
+        std::optional<InputReplay> replay;
+        if (const auto path = option("--replay")) {
+            replay.emplace(*path);
+        }
+
+        if (!args.empty() && args[0] == "--bench-kinematics") {
+            const std::size_t count = isNumber(1) ? std::stoul(std::string(args[1])) : 100000;
+            runKinematicsBenchmark(count, 600);
+            return EXIT_SUCCESS;
+        }
+        if (!args.empty() && args[0] == "--stress-jobs") {
+            const unsigned int rounds = isNumber(1) ? static_cast<unsigned int>(std::stoul(std::string(args[1]))) : 1000;
+            return runJobStressTest(rounds) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (!args.empty() && args[0] == "--bench-world") {
+            const bool render = std::ranges::find(args, "--render") != args.end();
+            const std::size_t count = isNumber(1) ? std::stoul(std::string(args[1])) : 10000;
+            const unsigned int defaultTicks = replay ? replay->getTickCount() : 3600;
+            const unsigned int ticks = isNumber(2) ? static_cast<unsigned int>(std::stoul(std::string(args[2]))) : defaultTicks;
+            const auto particles = option("--particles");
+            const bool withinBudget = runWorldBenchmark(count, particles ? std::stoul(*particles) : 0, ticks, render,
+                replay ? &*replay : nullptr);
+            return withinBudget ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        // Loose Textures/ and Fonts/ files are only needed when there is no pack
+        const std::string packPath = option("--assets").value_or("Assets.pack");
+        if (!AssetPack::instance().mount(packPath)) {
+            Assets::checkManifest();
+        }
+
+        // A replay only reproduces the run at the tick rate it was recorded at
+        const unsigned int ticksPerSecond = replay ? replay->getTicksPerSecond() : 60;
+        std::optional<InputRecorder> recorder;
+        const auto recordPath = option("--record");
+        if (recordPath) {
+            recorder.emplace(ticksPerSecond);
+        }
+
+        StatefulGame game(ticksPerSecond);
+        if (const auto fps = option("--fps")) {
+            game.setFramePacing(FramePacer(FramePacer::TargetRate, static_cast<unsigned int>(std::stoul(*fps))));
+        }
+        else if (std::ranges::find(args, "--unlimited") != args.end()) {
+            game.setFramePacing(FramePacer(FramePacer::Unlimited));
+        }
+        game.getPlayer().setReplay(replay ? &*replay : nullptr);
+        game.getPlayer().setRecorder(recorder ? &*recorder : nullptr);
+        if (std::ranges::find(args, "--pipelined") != args.end()) {
+            game.runPipelined();
+        }
+        else {
+            game.run();
+        }
+
+        if (recorder) {
+            recorder->save(*recordPath);
+        }
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;